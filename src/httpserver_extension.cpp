@@ -1,8 +1,11 @@
 #define DUCKDB_EXTENSION_MAIN
 #define CPPHTTPLIB_OPENSSL_SUPPORT
 
+#include <cerrno>
 #include <chrono>
 #include <cstdlib>
+#include <functional>
+#include <random>
 #include <thread>
 #include "httpserver_extension.hpp"
 #include "query_stats.hpp"
@@ -11,8 +14,15 @@
 #include "duckdb/function/scalar_function.hpp"
 #include "duckdb/main/extension_util.hpp"
 #include "duckdb/common/allocator.hpp"
+#include "duckdb/common/types/hash.hpp"
+#include "duckdb/main/client_context_state.hpp"
+#include "duckdb/transaction/meta_transaction.hpp"
 #include "result_serializer.hpp"
 #include "result_serializer_compact_json.hpp"
+#include "result_serializer_clickhouse_binary.hpp"
+#include "response_spill.hpp"
+#include "httpserver_flock.hpp"
+#include "query_log.hpp"
 #include "httplib.hpp"
 #include "yyjson.hpp"
 #include "playground.hpp"
@@ -32,8 +42,16 @@ struct HttpServerState {
     DatabaseInstance* db_instance;
     unique_ptr<Allocator> allocator;
     std::string auth_token;
-
-    HttpServerState() : is_running(false), db_instance(nullptr) {}
+    idx_t spill_threshold;
+    idx_t spill_ttl;
+    bool etag_enabled;
+    // Random per server start, so tags issued before a restart never match data changed while it was down
+    uint64_t etag_epoch;
+    unique_ptr<FlockPeers> flock_peers;
+    idx_t flock_timeout;
+
+    HttpServerState() : is_running(false), db_instance(nullptr), spill_threshold(0), spill_ttl(3600),
+                        etag_enabled(false), etag_epoch(0), flock_timeout(30) {}
 };
 
 static HttpServerState global_state;
@@ -123,30 +141,128 @@ static std::string ConvertResultToNDJSON(MaterializedQueryResult &result) {
     return ndjson_output;
 }
 
-// Handle both GET and POST requests
-void HandleHttpRequest(const duckdb_httplib_openssl::Request& req, duckdb_httplib_openssl::Response& res) {
-    std::string query;
+// Set the response body, parking it in a temp file if it is above the spill threshold
+static void SetResponseContent(duckdb_httplib_openssl::Response &res, std::string body, const std::string &content_type) {
+    if (global_state.spill_threshold == 0 || body.size() < global_state.spill_threshold || !global_state.db_instance) {
+        res.set_content(std::move(body), content_type);
+        return;
+    }
 
-    // Check authentication
-    if (!IsAuthenticated(req)) {
-        res.status = 401;
-        res.set_content("Unauthorized", "text/plain");
+    shared_ptr<SpilledResponse> spill;
+    try {
+        spill = make_shared_ptr<SpilledResponse>(*global_state.db_instance, body);
+    } catch (const std::exception &) {
+        // Spilling is best effort, serve from memory if the temp directory is unusable
+        res.set_content(std::move(body), content_type);
         return;
     }
+    // Release the heap copy now, the file is streamed from here on
+    std::string().swap(body);
+
+    // The spill file is removed once the response (and with it the provider) is destroyed,
+    // regardless of whether the client read all of it
+    res.set_content_provider(
+        spill->Size(), content_type,
+        [spill](size_t offset, size_t length, duckdb_httplib_openssl::DataSink &sink) {
+            char buffer[65536];
+            auto to_read = MinValue<idx_t>(length, sizeof(buffer));
+            try {
+                spill->Read(buffer, offset, to_read);
+            } catch (const std::exception &) {
+                return false;
+            }
+            return sink.write(buffer, to_read);
+        });
+}
 
-    // CORS allow
-    res.set_header("Access-Control-Allow-Origin", "*");
-    res.set_header("Access-Control-Allow-Methods", "GET, POST, OPTIONS, PUT");
-    res.set_header("Access-Control-Allow-Headers", "*");
-    res.set_header("Access-Control-Allow-Credentials", "true");
-    res.set_header("Access-Control-Max-Age", "86400");
+// Number of commits that modified a database through a tracked connection, used to invalidate ETags
+static std::atomic<idx_t> commit_version {0};
+
+// Bumps the commit version around every commit that wrote to a database
+class CommitVersionState : public ClientContextState {
+public:
+    void TransactionCommit(MetaTransaction &transaction, ClientContext &context) override {
+        if (transaction.ModifiedDatabase()) {
+            // Bump before and after the commit becomes visible, so a tag computed in between is invalidated
+            commit_version++;
+            pending_commit = true;
+        }
+    }
 
-    // Handle preflight OPTIONS request
-    if (req.method == "OPTIONS") {
-        res.status = 204;  // No content
-        return;
+    void QueryEnd(ClientContext &context) override {
+        if (pending_commit) {
+            commit_version++;
+            pending_commit = false;
+        }
     }
 
+private:
+    bool pending_commit = false;
+};
+
+static void TrackCommits(ClientContext &context) {
+    context.registered_state->GetOrCreate<CommitVersionState>("httpserver_commit_version");
+}
+
+// Compute the ETag of a query response, or an empty string if the response must not be cached.
+// The version is read before the query runs, so a concurrent commit can only make the tag older than the data.
+// Commits are only observed on server connections and the connection that started the server
+static std::string ComputeETag(Connection &con, const duckdb_httplib_openssl::Request& req,
+                               const std::string &query, const std::string &format) {
+    try {
+        // Only plain reads are cacheable, anything else may change the data it reports on
+        auto statements = con.ExtractStatements(query);
+        if (statements.empty()) {
+            return "";
+        }
+        for (auto &statement : statements) {
+            if (statement->type != StatementType::SELECT_STATEMENT) {
+                return "";
+            }
+        }
+
+        idx_t version = commit_version.load();
+
+        hash_t etag = Hash(query.c_str(), query.size());
+        etag = CombineHash(etag, Hash(format.c_str(), format.size()));
+        // httplib keeps params in a multimap, so iteration order is stable
+        for (auto &param : req.params) {
+            etag = CombineHash(etag, Hash(param.first.c_str(), param.first.size()));
+            etag = CombineHash(etag, Hash(param.second.c_str(), param.second.size()));
+        }
+        etag = CombineHash(etag, Hash(version));
+        etag = CombineHash(etag, Hash(global_state.etag_epoch));
+
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), "\"%016llx\"", static_cast<unsigned long long>(etag));
+        return std::string(buffer);
+    } catch (const std::exception &) {
+        // Let the query itself report parse errors
+        return "";
+    }
+}
+
+// Check whether the If-None-Match header of the request matches the ETag
+static bool ETagMatches(const duckdb_httplib_openssl::Request& req, const std::string &etag) {
+    if (!req.has_header("If-None-Match")) {
+        return false;
+    }
+    auto if_none_match = req.get_header_value("If-None-Match");
+    for (auto &candidate : StringUtil::Split(if_none_match, ',')) {
+        StringUtil::Trim(candidate);
+        // Weak comparison, as mandated for If-None-Match
+        if (StringUtil::StartsWith(candidate, "W/")) {
+            candidate = candidate.substr(2);
+        }
+        if (candidate == "*" || candidate == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Extract the query from the URL parameters or the POST body
+static bool GetRequestQuery(const duckdb_httplib_openssl::Request& req, std::string &query) {
     // Check if the query is in the URL parameters
     if (req.has_param("query")) {
         query = req.get_param_value("query");
@@ -158,14 +274,15 @@ void HandleHttpRequest(const duckdb_httplib_openssl::Request& req, duckdb_httpli
     else if (req.method == "POST" && !req.body.empty()) {
         query = req.body;
     }
-    // If no query found, return an error
     else {
-        res.status = 200;
-        res.set_content(reinterpret_cast<char const*>(playgroundContent), "text/html");
-        return;
+        return false;
     }
+    return true;
+}
 
-    // Set default format to JSONCompact
+// Extract the output format from the URL parameters or headers
+static std::string GetRequestFormat(const duckdb_httplib_openssl::Request& req) {
+    // Set default format to JSONEachRow
     std::string format = "JSONEachRow";
 
     // Check for format in URL parameter or header
@@ -176,59 +293,525 @@ void HandleHttpRequest(const duckdb_httplib_openssl::Request& req, duckdb_httpli
     } else if (req.has_header("format")) {
         format = req.get_header_value("format");
     }
+    return format;
+}
+
+// Parse a decimal integer, rejecting empty, partial, negative and out of range input
+static bool TryParseUnsigned(const std::string &value, idx_t &result) {
+    if (value.empty() || !StringUtil::CharacterIsDigit(value[0])) {
+        return false;
+    }
+    char *end = nullptr;
+    errno = 0;
+    auto parsed = std::strtoull(value.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0') {
+        return false;
+    }
+    result = parsed;
+    return true;
+}
+
+// Parse a strictly positive decimal integer
+static bool TryParsePositive(const std::string &value, idx_t &result) {
+    idx_t parsed;
+    if (!TryParseUnsigned(value, parsed) || parsed == 0) {
+        return false;
+    }
+    result = parsed;
+    return true;
+}
+
+// Fan a query out to the configured peers and stream back the merged result
+void HandleFlockRequest(const duckdb_httplib_openssl::Request& req, duckdb_httplib_openssl::Response& res) {
+    if (!IsAuthenticated(req)) {
+        res.status = 401;
+        res.set_content("Unauthorized", "text/plain");
+        return;
+    }
+
+    res.set_header("Access-Control-Allow-Origin", "*");
+
+    std::string query;
+    if (!GetRequestQuery(req, query)) {
+        res.status = 400;
+        res.set_content("Missing query", "text/plain");
+        return;
+    }
+
+    // Abort the whole response on the first failing peer unless asked to skip it
+    auto policy = FlockFailurePolicy::FAIL;
+    if (req.has_param("flock_policy")) {
+        auto policy_name = req.get_param_value("flock_policy");
+        if (policy_name == "skip") {
+            policy = FlockFailurePolicy::SKIP;
+        } else if (policy_name != "fail") {
+            res.status = 400;
+            res.set_content("Unsupported flock_policy: " + policy_name, "text/plain");
+            return;
+        }
+    }
+
+    idx_t timeout = global_state.flock_timeout;
+    if (req.has_param("flock_timeout")) {
+        auto timeout_value = req.get_param_value("flock_timeout");
+        if (!TryParsePositive(timeout_value, timeout)) {
+            res.status = 400;
+            res.set_content("Unsupported flock_timeout: " + timeout_value, "text/plain");
+            return;
+        }
+    }
+
+    global_state.flock_peers->HandleRequest(req, res, query, GetRequestFormat(req), policy, timeout);
+}
+
+// Name of the authenticated user for the query log
+static std::string GetRequestUser(const duckdb_httplib_openssl::Request& req) {
+    auto auth = req.get_header_value("Authorization");
+    if (!auth.empty() && auth.compare(0, 6, "Basic ") == 0) {
+        auto decoded_auth = base64_decode(auth.substr(6));
+        return decoded_auth.substr(0, decoded_auth.find(':'));
+    }
+    if (req.has_header("X-API-Key")) {
+        return "api_key";
+    }
+    return "";
+}
+
+static double SecondsBetween(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// Serialize a query result in the requested format, returns the body and sets its content type
+static std::string SerializeResult(MaterializedQueryResult &result, const std::string &format, ReqStats &stats,
+                                   std::string &content_type) {
+    ClickHouseBinaryFormat binary_format;
+    if (format == "JSONEachRow") {
+        content_type = "application/x-ndjson";
+        return ConvertResultToNDJSON(result);
+    } else if (format == "JSONCompact") {
+        content_type = "application/json";
+        ResultSerializerCompactJson serializer;
+        return serializer.Serialize(result, stats);
+    } else if (ResultSerializerClickHouseBinary::TryGetFormat(format, binary_format)) {
+        content_type = "application/octet-stream";
+        ResultSerializerClickHouseBinary serializer(binary_format);
+        return serializer.Serialize(result);
+    }
+    // Default to NDJSON for DuckDB's own queries
+    content_type = "application/x-ndjson";
+    return ConvertResultToNDJSON(result);
+}
+
+// Called with the progress of a running query, returning false interrupts the query
+typedef std::function<bool(const QueryProgress &progress, double elapsed_sec)> ProgressCallback;
+
+// Run a query task by task, reporting its progress every interval and once more when it is done.
+// Only the last statement reports progress, the ones before it run as usual
+static unique_ptr<MaterializedQueryResult> ExecuteWithProgress(Connection &con, const std::string &query,
+                                                               idx_t interval_ms, const ProgressCallback &callback) {
+    con.context->config.enable_progress_bar = true;
+    con.context->config.print_progress_bar = false;
+
+    auto statements = con.ExtractStatements(query);
+    if (statements.empty()) {
+        throw InvalidInputException("No statement to execute");
+    }
+    for (idx_t i = 0; i + 1 < statements.size(); i++) {
+        auto result = con.Query(std::move(statements[i]));
+        if (result->HasError()) {
+            return result;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto next_report = start + std::chrono::milliseconds(interval_ms);
+    auto pending = con.PendingQuery(std::move(statements.back()));
+    if (pending->HasError()) {
+        return make_uniq<MaterializedQueryResult>(pending->GetErrorObject());
+    }
+
+    PendingExecutionResult status;
+    do {
+        status = pending->ExecuteTask();
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_report) {
+            if (!callback(con.context->GetQueryProgress(), SecondsBetween(start, now))) {
+                con.Interrupt();
+            }
+            next_report = now + std::chrono::milliseconds(interval_ms);
+        }
+        if (status == PendingExecutionResult::BLOCKED || status == PendingExecutionResult::NO_TASKS_AVAILABLE) {
+            // Other threads are busy with the query, don't spin on the lock
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    } while (status == PendingExecutionResult::RESULT_NOT_READY || status == PendingExecutionResult::BLOCKED ||
+             status == PendingExecutionResult::NO_TASKS_AVAILABLE);
+
+    if (pending->HasError()) {
+        return make_uniq<MaterializedQueryResult>(pending->GetErrorObject());
+    }
+    callback(con.context->GetQueryProgress(), SecondsBetween(start, std::chrono::steady_clock::now()));
+    return unique_ptr_cast<QueryResult, MaterializedQueryResult>(pending->Execute());
+}
+
+// Progress interval requested by the client, defaulting to the one of ClickHouse and clamped to 10ms - 60s.
+// Returns false if the parameter is not a positive number
+static bool TryGetProgressInterval(const duckdb_httplib_openssl::Request& req, idx_t &interval_ms) {
+    interval_ms = 100;
+    if (req.has_param("http_headers_progress_interval_ms") &&
+        !TryParsePositive(req.get_param_value("http_headers_progress_interval_ms"), interval_ms)) {
+        return false;
+    }
+    interval_ms = MinValue<idx_t>(MaxValue<idx_t>(interval_ms, 10), 60000);
+    return true;
+}
+
+// Progress in the shape of ClickHouse's X-ClickHouse-Progress header, which sends numbers as strings.
+// DuckDB does not count scanned bytes, so read_bytes is always zero
+static std::string FormatProgressHeader(idx_t read_rows, idx_t total_rows, uint64_t elapsed_ns) {
+    return StringUtil::Format("{\"read_rows\":\"%llu\",\"read_bytes\":\"0\",\"total_rows_to_read\":\"%llu\","
+                              "\"elapsed_ns\":\"%llu\"}",
+                              read_rows, total_rows, elapsed_ns);
+}
+
+// The X-ClickHouse-Summary header, which adds written and result sizes to the final progress.
+// DuckDB does not report written rows and bytes through the result, so those are zero
+static std::string FormatSummaryHeader(idx_t read_rows, idx_t total_rows, uint64_t elapsed_ns, idx_t result_rows,
+                                       idx_t result_bytes) {
+    return StringUtil::Format("{\"read_rows\":\"%llu\",\"read_bytes\":\"0\",\"written_rows\":\"0\","
+                              "\"written_bytes\":\"0\",\"total_rows_to_read\":\"%llu\",\"result_rows\":\"%llu\","
+                              "\"result_bytes\":\"%llu\",\"elapsed_ns\":\"%llu\"}",
+                              read_rows, total_rows, result_rows, result_bytes, elapsed_ns);
+}
+
+// Progress as the data of a server-sent event, percentage is -1 while DuckDB cannot estimate it
+static std::string FormatProgressEvent(const QueryProgress &progress, double elapsed_sec) {
+    return StringUtil::Format("{\"read_rows\":%llu,\"read_bytes\":0,\"total_rows_to_read\":%llu,"
+                              "\"percentage\":%.1f,\"elapsed\":%.3f}",
+                              progress.GetRowsProcesseed(), progress.GetTotalRowsToProcess(),
+                              progress.GetPercentage(), elapsed_sec);
+}
+
+// Write a server-sent event, every line of the data goes into its own data field
+static bool WriteEvent(duckdb_httplib_openssl::DataSink &sink, const std::string &event, const std::string &data,
+                       idx_t &bytes_written) {
+    std::string message = "event: " + event + "\n";
+    idx_t line_start = 0;
+    while (line_start <= data.size()) {
+        auto line_end = data.find('\n', line_start);
+        if (line_end == std::string::npos) {
+            line_end = data.size();
+        }
+        message += "data: ";
+        message.append(data, line_start, line_end - line_start);
+        message += "\n";
+        line_start = line_end + 1;
+    }
+    message += "\n";
+    bytes_written += message.size();
+    return sink.write(message.data(), message.size());
+}
+
+static void RecordQuery(QueryLogEntry &entry, idx_t bytes, int status) {
+    entry.query_hash = Hash(entry.query.c_str(), entry.query.size());
+    entry.bytes = bytes;
+    entry.status = status;
+    QueryLog::Get().Record(entry);
+}
+
+// Run the query while the response is being sent, streaming its progress as server-sent events
+// followed by a result or an error event. The query log entry is recorded once the stream ends
+static void StreamQueryWithProgress(duckdb_httplib_openssl::Response& res, const std::string &query,
+                                    const std::string &format, idx_t interval_ms,
+                                    std::chrono::steady_clock::time_point received, QueryLogEntry entry) {
+    auto db = global_state.db_instance;
+    res.set_header("Cache-Control", "no-cache");
+    res.set_chunked_content_provider(
+        "text/event-stream",
+        [db, query, format, interval_ms, received, entry](size_t /*offset*/,
+                                                           duckdb_httplib_openssl::DataSink &sink) mutable {
+            idx_t bytes_written = 0;
+            int status = 200;
+            try {
+                Connection con(*db);
+                // Writes sent as event streams must invalidate ETags like any other
+                if (global_state.etag_enabled) {
+                    TrackCommits(*con.context);
+                }
+                ReqStats stats{0, 0, 0};
+                auto exec_start = std::chrono::steady_clock::now();
+                auto result = ExecuteWithProgress(con, query, interval_ms,
+                                                  [&](const QueryProgress &progress, double elapsed_sec) {
+                    stats.read_rows = progress.GetRowsProcesseed();
+                    // A failed write means the client went away, which cancels the query
+                    return WriteEvent(sink, "progress", FormatProgressEvent(progress, elapsed_sec), bytes_written);
+                });
+                auto exec_end = std::chrono::steady_clock::now();
+                entry.queue_time = SecondsBetween(received, exec_start);
+                entry.exec_time = SecondsBetween(exec_start, exec_end);
+                stats.elapsed_sec = static_cast<float>(entry.exec_time);
+
+                if (result->HasError()) {
+                    status = 500;
+                    WriteEvent(sink, "error", result->GetError(), bytes_written);
+                } else {
+                    entry.rows = result->RowCount();
+                    std::string content_type;
+                    auto body = SerializeResult(*result, format, stats, content_type);
+                    entry.serialize_time = SecondsBetween(exec_end, std::chrono::steady_clock::now());
+                    WriteEvent(sink, "result", body, bytes_written);
+                }
+            } catch (const std::exception& ex) {
+                status = 500;
+                WriteEvent(sink, "error", "Code: 59, e.displayText() = DB::Exception: " + std::string(ex.what()),
+                           bytes_written);
+            }
+            sink.done();
+            RecordQuery(entry, bytes_written, status);
+            return true;
+        });
+}
+
+// Returns whether the request ran a query that still has to be recorded in the query log
+static bool HandleQueryRequest(const duckdb_httplib_openssl::Request& req, duckdb_httplib_openssl::Response& res,
+                               QueryLogEntry &entry) {
+    auto received = std::chrono::steady_clock::now();
+    std::string query;
+
+    // Check authentication
+    if (!IsAuthenticated(req)) {
+        res.status = 401;
+        res.set_content("Unauthorized", "text/plain");
+        return false;
+    }
+
+    // CORS allow
+    res.set_header("Access-Control-Allow-Origin", "*");
+    res.set_header("Access-Control-Allow-Methods", "GET, POST, OPTIONS, PUT");
+    res.set_header("Access-Control-Allow-Headers", "*");
+    res.set_header("Access-Control-Allow-Credentials", "true");
+    res.set_header("Access-Control-Max-Age", "86400");
+
+    // Handle preflight OPTIONS request
+    if (req.method == "OPTIONS") {
+        res.status = 204;  // No content
+        return false;
+    }
+
+    // If no query found, serve the playground
+    if (!GetRequestQuery(req, query)) {
+        res.status = 200;
+        res.set_content(reinterpret_cast<char const*>(playgroundContent), "text/html");
+        return false;
+    }
+
+    std::string format = GetRequestFormat(req);
+    entry.query = query;
+    entry.format = format;
 
     try {
         if (!global_state.db_instance) {
             throw IOException("Database instance not initialized");
         }
 
+        idx_t progress_interval;
+        if (!TryGetProgressInterval(req, progress_interval)) {
+            res.status = 400;
+            res.set_content("Unsupported http_headers_progress_interval_ms: " +
+                            req.get_param_value("http_headers_progress_interval_ms"), "text/plain");
+            return true;
+        }
+
+        // Live progress as server-sent events, only text formats can be carried in event data
+        if (req.get_header_value("Accept").find("text/event-stream") != std::string::npos) {
+            ClickHouseBinaryFormat binary_format;
+            if (ResultSerializerClickHouseBinary::TryGetFormat(format, binary_format)) {
+                res.status = 400;
+                res.set_content("Format " + format + " cannot be sent as an event stream", "text/plain");
+                return true;
+            }
+            StreamQueryWithProgress(res, query, format, progress_interval, received, entry);
+            return false;
+        }
+
         Connection con(*global_state.db_instance);
+
+        // Conditional GET, answer unchanged results without running the query
+        std::string etag;
+        if (global_state.etag_enabled) {
+            TrackCommits(*con.context);
+            etag = ComputeETag(con, req, query, format);
+        }
+        if (!etag.empty() && ETagMatches(req, etag)) {
+            res.status = 304;
+            res.set_header("ETag", etag);
+            res.set_header("Cache-Control", "no-cache");
+            return true;
+        }
+
+        // httplib sends all headers at once, so the progress headers carry the final progress of the query
+        bool progress_headers = req.get_param_value("send_progress_in_http_headers") == "1";
+
         auto start = std::chrono::system_clock::now();
-        auto result = con.Query(query);
+        auto exec_start = std::chrono::steady_clock::now();
+        unique_ptr<MaterializedQueryResult> result;
+        idx_t read_rows = 0;
+        idx_t total_rows = 0;
+        uint64_t progress_elapsed_ns = 0;
+        if (progress_headers) {
+            result = ExecuteWithProgress(con, query, progress_interval,
+                                         [&](const QueryProgress &query_progress, double elapsed_sec) {
+                read_rows = query_progress.GetRowsProcesseed();
+                total_rows = query_progress.GetTotalRowsToProcess();
+                progress_elapsed_ns = static_cast<uint64_t>(elapsed_sec * 1e9);
+                return true;
+            });
+        } else {
+            result = con.Query(query);
+        }
+        auto exec_end = std::chrono::steady_clock::now();
         auto end = std::chrono::system_clock::now();
         auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        entry.queue_time = SecondsBetween(received, exec_start);
+        entry.exec_time = SecondsBetween(exec_start, exec_end);
 
         if (result->HasError()) {
             res.status = 500;
             res.set_content(result->GetError(), "text/plain");
-            return;
+            return true;
         }
 
+        if (!etag.empty()) {
+            res.set_header("ETag", etag);
+            res.set_header("Cache-Control", "no-cache");
+        }
+        entry.rows = result->RowCount();
 
         ReqStats stats{
             static_cast<float>(elapsed.count()) / 1000,
             0,
-            0
+            read_rows
         };
 
-        // Format Options
-        if (format == "JSONEachRow") {
-            std::string json_output = ConvertResultToNDJSON(*result);
-            res.set_content(json_output, "application/x-ndjson");
-        } else if (format == "JSONCompact") {
-        	ResultSerializerCompactJson serializer;
-        	std::string json_output = serializer.Serialize(*result, stats);
-            res.set_content(json_output, "application/json");
-        } else {
-            // Default to NDJSON for DuckDB's own queries
-            std::string json_output = ConvertResultToNDJSON(*result);
-            res.set_content(json_output, "application/x-ndjson");
+        std::string content_type;
+        auto body = SerializeResult(*result, format, stats, content_type);
+        if (progress_headers) {
+            res.set_header("X-ClickHouse-Progress", FormatProgressHeader(read_rows, total_rows, progress_elapsed_ns));
+            res.set_header("X-ClickHouse-Summary", FormatSummaryHeader(read_rows, total_rows, progress_elapsed_ns,
+                                                                       entry.rows, body.size()));
         }
+        SetResponseContent(res, std::move(body), content_type);
+        entry.serialize_time = SecondsBetween(exec_end, std::chrono::steady_clock::now());
 
     } catch (const Exception& ex) {
         res.status = 500;
         std::string error_message = "Code: 59, e.displayText() = DB::Exception: " + std::string(ex.what());
         res.set_content(error_message, "text/plain");
     }
+    return true;
+}
+
+// Handle both GET and POST requests
+void HandleHttpRequest(const duckdb_httplib_openssl::Request& req, duckdb_httplib_openssl::Response& res) {
+    QueryLogEntry entry;
+    entry.timestamp = Timestamp::GetCurrentTimestamp();
+    entry.user = GetRequestUser(req);
+    entry.client_address = req.remote_addr;
+
+    // The playground, preflights and progress streams are not recorded here, the latter record themselves
+    if (!HandleQueryRequest(req, res, entry)) {
+        return;
+    }
+    // httplib only fills in the default status after the handler returns
+    RecordQuery(entry, res.body.empty() ? res.content_length_ : res.body.size(), res.status == -1 ? 200 : res.status);
+}
+
+// Set up the OpenSSL context of the TLS listener
+static bool ConfigureTLS(SSL_CTX &ctx, const std::string &cert_path, const std::string &key_path) {
+    SSL_CTX_set_min_proto_version(&ctx, TLS1_2_VERSION);
+    SSL_CTX_set_options(&ctx, SSL_OP_NO_COMPRESSION | SSL_OP_NO_SESSION_RESUMPTION_ON_RENEGOTIATION);
+
+    if (SSL_CTX_use_certificate_chain_file(&ctx, cert_path.c_str()) != 1 ||
+        SSL_CTX_use_PrivateKey_file(&ctx, key_path.c_str(), SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_check_private_key(&ctx) != 1) {
+        return false;
+    }
+
+    // Let reconnecting clients skip the full handshake, through session tickets (on by default)
+    // or the server side session cache for clients without ticket support
+    static const unsigned char session_id_context[] = "duckdb-httpserver";
+    SSL_CTX_set_session_id_context(&ctx, session_id_context, sizeof(session_id_context) - 1);
+    SSL_CTX_set_session_cache_mode(&ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(&ctx, 10240);
+    SSL_CTX_set_timeout(&ctx, 3600);
+
+#ifdef SSL_OP_ENABLE_KTLS
+    // Hand record encryption to the kernel where OpenSSL and the kernel support it
+    SSL_CTX_set_options(&ctx, SSL_OP_ENABLE_KTLS);
+#endif
+    return true;
 }
 
-void HttpServerStart(DatabaseInstance& db, string_t host, int32_t port, string_t auth = string_t()) {
+void HttpServerStart(DatabaseInstance& db, string_t host, int32_t port, string_t auth = string_t(),
+                     string_t cert = string_t(), string_t key = string_t()) {
     if (global_state.is_running) {
         throw IOException("HTTP server is already running");
     }
 
+    auto cert_path = cert.GetString();
+    auto key_path = key.GetString();
+    if (cert_path.empty() != key_path.empty()) {
+        throw InvalidInputException("Both a certificate and a private key are required for TLS");
+    }
+
+    // Validate settings before the server exists, so a bad value leaves nothing half started
+    idx_t flock_timeout = 30;
+    const char* flock_timeout_env = std::getenv("DUCKDB_HTTPSERVER_FLOCK_TIMEOUT");
+    if (flock_timeout_env && !TryParsePositive(flock_timeout_env, flock_timeout)) {
+        throw InvalidInputException("DUCKDB_HTTPSERVER_FLOCK_TIMEOUT must be a positive number of seconds, got '%s'",
+                                    flock_timeout_env);
+    }
+
+    // Responses larger than this many bytes are spilled to temp_directory while being sent, 0 disables spilling
+    idx_t spill_threshold = 0;
+    const char* spill_threshold_env = std::getenv("DUCKDB_HTTPSERVER_SPILL_THRESHOLD");
+    if (spill_threshold_env && !TryParseUnsigned(spill_threshold_env, spill_threshold)) {
+        throw InvalidInputException("DUCKDB_HTTPSERVER_SPILL_THRESHOLD must be a number of bytes, got '%s'",
+                                    spill_threshold_env);
+    }
+    idx_t spill_ttl = 3600;
+    const char* spill_ttl_env = std::getenv("DUCKDB_HTTPSERVER_SPILL_TTL");
+    if (spill_ttl_env && !TryParsePositive(spill_ttl_env, spill_ttl)) {
+        throw InvalidInputException("DUCKDB_HTTPSERVER_SPILL_TTL must be a positive number of seconds, got '%s'",
+                                    spill_ttl_env);
+    }
+    if (spill_threshold > 0) {
+        SpilledResponse::RemoveExpiredFiles(db, spill_ttl);
+    }
+
+    // Query log capacity, 0 disables the log
+    idx_t query_log_size = 1024;
+    const char* query_log_size_env = std::getenv("DUCKDB_HTTPSERVER_QUERY_LOG_SIZE");
+    if (query_log_size_env &&
+        (!TryParseUnsigned(query_log_size_env, query_log_size) || query_log_size > QueryLog::MAX_CAPACITY)) {
+        throw InvalidInputException("DUCKDB_HTTPSERVER_QUERY_LOG_SIZE must be a number of queries up to %llu, got '%s'",
+                                    QueryLog::MAX_CAPACITY, query_log_size_env);
+    }
+    QueryLog::Get().Reset(query_log_size);
+
+    if (cert_path.empty()) {
+        global_state.server = make_uniq<duckdb_httplib_openssl::Server>();
+    } else {
+        auto server = make_uniq<duckdb_httplib_openssl::SSLServer>([&](SSL_CTX &ctx) {
+            return ConfigureTLS(ctx, cert_path, key_path);
+        });
+        if (!server->is_valid()) {
+            throw IOException("Failed to load TLS certificate " + cert_path + " and key " + key_path);
+        }
+        global_state.server = std::move(server);
+    }
+
     global_state.db_instance = &db;
-    global_state.server = make_uniq<duckdb_httplib_openssl::Server>();
     global_state.is_running = true;
     global_state.auth_token = auth.GetString();
 
@@ -240,6 +823,15 @@ void HttpServerStart(DatabaseInstance& db, string_t host, int32_t port, string_t
         base_path = std::string(base_path_env);
     }
 
+    global_state.spill_threshold = spill_threshold;
+    global_state.spill_ttl = spill_ttl;
+
+    // ETags only track commits made through tracked connections, not external files or volatile functions, so they are opt-in
+    const char* etag_env = std::getenv("DUCKDB_HTTPSERVER_ETAG");
+    global_state.etag_enabled = (etag_env != nullptr && std::string(etag_env) == "1");
+    std::random_device random_device;
+    global_state.etag_epoch = (static_cast<uint64_t>(random_device()) << 32) | random_device();
+
     // CORS Preflight
     global_state.server->Options(base_path,
     [](const duckdb_httplib_openssl::Request& /*req*/, duckdb_httplib_openssl::Response& res) {
@@ -259,6 +851,22 @@ void HttpServerStart(DatabaseInstance& db, string_t host, int32_t port, string_t
     global_state.server->Get(base_path, HandleHttpRequest);
     global_state.server->Post(base_path, HandleHttpRequest);
 
+    const char* query_log_parquet_env = std::getenv("DUCKDB_HTTPSERVER_QUERY_LOG_PARQUET");
+    if (query_log_parquet_env && query_log_parquet_env[0] != '\0') {
+        QueryLog::Get().StartFlusher(db, query_log_parquet_env);
+    }
+
+    // Scatter-gather endpoint, only available when peers are configured
+    const char* peers_env = std::getenv("DUCKDB_HTTPSERVER_PEERS");
+    if (peers_env) {
+        global_state.flock_peers = make_uniq<FlockPeers>(peers_env);
+    }
+    global_state.flock_timeout = flock_timeout;
+    if (global_state.flock_peers && !global_state.flock_peers->Empty()) {
+        global_state.server->Get("/flock", HandleFlockRequest);
+        global_state.server->Post("/flock", HandleFlockRequest);
+    }
+
     // Health check endpoint
     global_state.server->Get("/ping", [](const duckdb_httplib_openssl::Request& req, duckdb_httplib_openssl::Response& res) {
         res.set_content("OK", "text/plain");
@@ -281,10 +889,8 @@ void HttpServerStart(DatabaseInstance& db, string_t host, int32_t port, string_t
             strftime(timestr, sizeof(timestr), "%d/%b/%Y:%H:%M:%S", tm_info);
             strftime(timezone, sizeof(timezone), "%z", tm_info);
 
-            size_t response_size = 0;
-            if (!res.body.empty()) {
-                response_size = res.body.size();
-            }
+            // Spilled responses are streamed by a content provider and leave the body empty
+            size_t response_size = res.body.empty() ? res.content_length_ : res.body.size();
             std::string user_agent = req.has_header("User-Agent") ? 
                 req.get_header_value("User-Agent") : "-";
             std::string referer = req.has_header("Referer") ? 
@@ -309,10 +915,8 @@ void HttpServerStart(DatabaseInstance& db, string_t host, int32_t port, string_t
     } else if (use_syslog != nullptr && std::string(use_syslog) == "1") {
         openlog("duckdb-httpserver", LOG_PID | LOG_NDELAY, LOG_LOCAL0);
         global_state.server->set_logger([](const duckdb_httplib_openssl::Request& req, const duckdb_httplib_openssl::Response& res) {
-            size_t response_size = 0;
-            if (!res.body.empty()) {
-                response_size = res.body.size();
-            }
+            // Spilled responses are streamed by a content provider and leave the body empty
+            size_t response_size = res.body.empty() ? res.content_length_ : res.body.size();
             std::string user_agent = req.has_header("User-Agent") ? 
                 req.get_header_value("User-Agent") : "-";
              std::string referer = req.has_header("Referer") ? 
@@ -381,6 +985,8 @@ void HttpServerStop() {
         }
         global_state.server.reset();
         global_state.server_thread.reset();
+        global_state.flock_peers.reset();
+        QueryLog::Get().StopFlusher();
         global_state.db_instance = nullptr;
         global_state.is_running = false;
 
@@ -394,23 +1000,36 @@ static void HttpServerCleanup() {
 }
 
 static void LoadInternal(DatabaseInstance &instance) {
-    auto httpserve_start = ScalarFunction("httpserve_start",
-                                        {LogicalType::VARCHAR, LogicalType::INTEGER, LogicalType::VARCHAR},
-                                        LogicalType::VARCHAR,
-                                        [&](DataChunk &args, ExpressionState &state, Vector &result) {
+    auto start_server = [&](DataChunk &args, ExpressionState &state, Vector &result) {
         auto &host_vector = args.data[0];
         auto &port_vector = args.data[1];
         auto &auth_vector = args.data[2];
+        auto tls = args.ColumnCount() == 5;
 
         UnaryExecutor::Execute<string_t, string_t>(
             host_vector, result, args.size(),
             [&](string_t host) {
                 auto port = ((int32_t*)port_vector.GetData())[0];
                 auto auth = ((string_t*)auth_vector.GetData())[0];
-                HttpServerStart(instance, host, port, auth);
-                return StringVector::AddString(result, "HTTP server started on " + host.GetString() + ":" + std::to_string(port));
+                auto cert = tls ? ((string_t*)args.data[3].GetData())[0] : string_t();
+                auto key = tls ? ((string_t*)args.data[4].GetData())[0] : string_t();
+                HttpServerStart(instance, host, port, auth, cert, key);
+                // Writes made by the connection that owns the server also invalidate ETags
+                if (global_state.etag_enabled) {
+                    TrackCommits(state.GetContext());
+                }
+                std::string protocol = tls ? "HTTPS" : "HTTP";
+                return StringVector::AddString(result, protocol + " server started on " + host.GetString() + ":" + std::to_string(port));
             });
-    });
+    };
+
+    ScalarFunctionSet httpserve_start("httpserve_start");
+    httpserve_start.AddFunction(ScalarFunction({LogicalType::VARCHAR, LogicalType::INTEGER, LogicalType::VARCHAR},
+                                               LogicalType::VARCHAR, start_server));
+    // TLS listener, with the paths of a PEM certificate chain and private key
+    httpserve_start.AddFunction(ScalarFunction({LogicalType::VARCHAR, LogicalType::INTEGER, LogicalType::VARCHAR,
+                                                LogicalType::VARCHAR, LogicalType::VARCHAR},
+                                               LogicalType::VARCHAR, start_server));
 
     auto httpserve_stop = ScalarFunction("httpserve_stop",
                                        {},
@@ -422,6 +1041,7 @@ static void LoadInternal(DatabaseInstance &instance) {
 
     ExtensionUtil::RegisterFunction(instance, httpserve_start);
     ExtensionUtil::RegisterFunction(instance, httpserve_stop);
+    QueryLog::RegisterFunction(instance);
 
     // Register the cleanup function to be called at exit
     std::atexit(HttpServerCleanup);
@@ -0,0 +1,268 @@
+#include "httpserver_flock.hpp"
+
+#include "duckdb/common/string_util.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+namespace duckdb {
+
+//! Upper bound of fetched but not yet sent bytes, peers are paused (and TCP pushes back) above it
+static constexpr idx_t FLOCK_MAX_PENDING_BYTES = 16 * 1024 * 1024;
+//! Upper bound of a result that is buffered whole before it is forwarded. RowBinary rows and Native columns
+//! can't be split without decoding their types, and under the skip policy a peer's rows are only forwarded
+//! once it completed, so a peer failing halfway never leaves partial results behind
+static constexpr idx_t FLOCK_MAX_BUFFERED_BYTES = 16 * 1024 * 1024;
+
+FlockPeer::FlockPeer(const std::string &url_p) : url(url_p), path("/") {
+	auto scheme_end = url.find("://");
+	auto path_start = url.find('/', scheme_end == std::string::npos ? 0 : scheme_end + 3);
+	if (path_start == std::string::npos) {
+		scheme_host_port = url;
+	} else {
+		scheme_host_port = url.substr(0, path_start);
+		path = url.substr(path_start);
+	}
+}
+
+unique_ptr<duckdb_httplib_openssl::Client> FlockPeer::Acquire() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!idle.empty()) {
+			auto client = std::move(idle.back());
+			idle.pop_back();
+			return client;
+		}
+	}
+	auto client = make_uniq<duckdb_httplib_openssl::Client>(scheme_host_port);
+	client->set_keep_alive(true);
+	return client;
+}
+
+void FlockPeer::Release(unique_ptr<duckdb_httplib_openssl::Client> client) {
+	std::lock_guard<std::mutex> guard(lock);
+	idle.push_back(std::move(client));
+}
+
+FlockPeers::FlockPeers(const std::string &peer_list) {
+	for (auto &url : StringUtil::Split(peer_list, ',')) {
+		StringUtil::Trim(url);
+		if (!url.empty()) {
+			peers.push_back(make_uniq<FlockPeer>(url));
+		}
+	}
+}
+
+//! Shared between the peer fetch threads and the content provider of the response
+struct FlockState {
+	std::mutex lock;
+	std::condition_variable cv;
+	//! Complete result lines that are ready to be sent
+	std::deque<std::string> pending;
+	idx_t pending_bytes = 0;
+	idx_t peers_running = 0;
+	//! First failure under the FAIL policy, aborts the response
+	std::string error;
+	//! Failures of all peers, reported when no peer succeeded
+	vector<std::string> failures;
+	idx_t peers_succeeded = 0;
+	bool cancelled = false;
+	vector<std::thread> workers;
+
+	~FlockState() {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			cancelled = true;
+		}
+		cv.notify_all();
+		for (auto &worker : workers) {
+			if (worker.joinable()) {
+				worker.join();
+			}
+		}
+	}
+
+	//! Queue data for the client, returns false if the fetch should be aborted
+	bool Push(std::string data) {
+		std::unique_lock<std::mutex> guard(lock);
+		cv.wait(guard, [&]() { return cancelled || !error.empty() || pending_bytes < FLOCK_MAX_PENDING_BYTES; });
+		if (cancelled || !error.empty()) {
+			return false;
+		}
+		pending_bytes += data.size();
+		pending.push_back(std::move(data));
+		cv.notify_all();
+		return true;
+	}
+
+	void PeerDone(const std::string &peer_error, FlockFailurePolicy policy) {
+		std::lock_guard<std::mutex> guard(lock);
+		if (peer_error.empty()) {
+			peers_succeeded++;
+		} else {
+			failures.push_back(peer_error);
+			if (policy == FlockFailurePolicy::FAIL && error.empty()) {
+				error = peer_error;
+			} else if (policy == FlockFailurePolicy::SKIP) {
+				fprintf(stderr, "httpserver: /flock skipped peer %s\n", peer_error.c_str());
+				fflush(stderr);
+			}
+		}
+		peers_running--;
+		cv.notify_all();
+	}
+};
+
+static void FetchFromPeer(FlockState &state, FlockPeer &peer, const std::string &query, const std::string &format,
+                          const duckdb_httplib_openssl::Headers &headers, FlockFailurePolicy policy,
+                          idx_t timeout_sec) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_sec);
+	auto client = peer.Acquire();
+	client->set_connection_timeout(static_cast<time_t>(timeout_sec), 0);
+	client->set_read_timeout(static_cast<time_t>(timeout_sec), 0);
+
+	duckdb_httplib_openssl::Request request;
+	request.method = "POST";
+	request.path = peer.Path() + "?default_format=" + format;
+	request.headers = headers;
+	request.body = query;
+	request.set_header("Content-Type", "text/plain");
+
+	int status = 0;
+	bool timed_out = false;
+	bool too_large = false;
+	auto line_based = format == "JSONEachRow";
+	// Rows are only forwarded as they arrive when a failing peer aborts the whole response anyway
+	auto streamed = line_based && policy == FlockFailurePolicy::FAIL;
+	std::string received;
+	request.response_handler = [&](const duckdb_httplib_openssl::Response &response) {
+		status = response.status;
+		return response.status == 200;
+	};
+	request.content_receiver = [&](const char *data, size_t data_length, uint64_t /*offset*/,
+	                               uint64_t /*total_length*/) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			timed_out = true;
+			return false;
+		}
+		received.append(data, data_length);
+		if (!streamed) {
+			// Forwarded once the peer is done, see FLOCK_MAX_BUFFERED_BYTES
+			if (received.size() > FLOCK_MAX_BUFFERED_BYTES) {
+				too_large = true;
+				return false;
+			}
+			return true;
+		}
+		// Only forward complete lines, so rows of different peers never interleave
+		auto last_newline = received.rfind('\n');
+		if (last_newline == std::string::npos) {
+			return true;
+		}
+		auto lines = received.substr(0, last_newline + 1);
+		received.erase(0, last_newline + 1);
+		return state.Push(std::move(lines));
+	};
+
+	auto result = client->send(request);
+	std::string peer_error;
+	// Rejecting a response in the handlers cancels the request, so report why it was rejected
+	if (status != 0 && status != 200) {
+		peer_error = peer.Url() + ": HTTP " + std::to_string(status);
+	} else if (timed_out) {
+		peer_error = peer.Url() + ": timed out after " + std::to_string(timeout_sec) + "s";
+	} else if (too_large) {
+		peer_error = peer.Url() + ": result exceeds " + std::to_string(FLOCK_MAX_BUFFERED_BYTES) + " bytes";
+	} else if (!result) {
+		peer_error = peer.Url() + ": " + duckdb_httplib_openssl::to_string(result.error());
+	} else {
+		if (!received.empty()) {
+			if (line_based && received.back() != '\n') {
+				received += "\n";
+			}
+			state.Push(std::move(received));
+		}
+		// Only connections that completed cleanly are safe to reuse
+		peer.Release(std::move(client));
+	}
+	state.PeerDone(peer_error, policy);
+}
+
+void FlockPeers::HandleRequest(const duckdb_httplib_openssl::Request &req, duckdb_httplib_openssl::Response &res,
+                               const std::string &query, const std::string &format, FlockFailurePolicy policy,
+                               idx_t timeout_sec) {
+	// Only formats whose streams can be concatenated without re-serialization can be merged
+	std::string content_type;
+	if (format == "JSONEachRow") {
+		content_type = "application/x-ndjson";
+	} else if (format == "RowBinary" || format == "Native") {
+		content_type = "application/octet-stream";
+	} else {
+		res.status = 400;
+		res.set_content("Unsupported flock format: " + format, "text/plain");
+		return;
+	}
+
+	// Peers are expected to share the credentials of this server
+	duckdb_httplib_openssl::Headers headers;
+	for (auto header : {"X-API-Key", "Authorization"}) {
+		if (req.has_header(header)) {
+			headers.emplace(header, req.get_header_value(header));
+		}
+	}
+
+	auto state = make_shared_ptr<FlockState>();
+	state->peers_running = peers.size();
+	for (auto &peer : peers) {
+		auto &peer_ref = *peer;
+		// Workers only hold a plain reference, the state joins them on destruction
+		auto state_ptr = state.get();
+		state->workers.emplace_back([state_ptr, &peer_ref, query, format, headers, policy, timeout_sec]() {
+			try {
+				FetchFromPeer(*state_ptr, peer_ref, query, format, headers, policy, timeout_sec);
+			} catch (const std::exception &ex) {
+				state_ptr->PeerDone(peer_ref.Url() + ": " + ex.what(), policy);
+			}
+		});
+	}
+
+	{
+		// Hold back the status until there is something to send, so a fan-out no peer answered can still fail
+		std::unique_lock<std::mutex> guard(state->lock);
+		state->cv.wait(guard,
+		               [&]() { return !state->error.empty() || !state->pending.empty() || state->peers_running == 0; });
+		if (!state->error.empty() || (state->pending.empty() && state->peers_succeeded == 0)) {
+			res.status = 502;
+			res.set_content("Flock failed:\n" + StringUtil::Join(state->failures, "\n") + "\n", "text/plain");
+			return;
+		}
+	}
+
+	auto provider = [state](size_t /*offset*/, duckdb_httplib_openssl::DataSink &sink) {
+		std::unique_lock<std::mutex> guard(state->lock);
+		state->cv.wait(guard,
+		               [&]() { return !state->error.empty() || !state->pending.empty() || state->peers_running == 0; });
+		if (!state->error.empty()) {
+			// Headers are already out, cut the stream so the client sees a failure
+			fprintf(stderr, "httpserver: /flock aborted, peer %s\n", state->error.c_str());
+			fflush(stderr);
+			return false;
+		}
+		if (!state->pending.empty()) {
+			auto data = std::move(state->pending.front());
+			state->pending.pop_front();
+			state->pending_bytes -= data.size();
+			state->cv.notify_all();
+			guard.unlock();
+			return sink.write(data.data(), data.size());
+		}
+		sink.done();
+		return true;
+	};
+	res.set_chunked_content_provider(content_type, provider);
+}
+
+} // namespace duckdb
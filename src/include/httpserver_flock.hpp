@@ -0,0 +1,65 @@
+#pragma once
+
+#ifndef CPPHTTPLIB_OPENSSL_SUPPORT
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#endif
+
+#include "duckdb.hpp"
+#include "httplib.hpp"
+
+#include <mutex>
+
+namespace duckdb {
+
+//! What to do when a peer fails or times out during a fan-out query
+enum class FlockFailurePolicy : uint8_t {
+	//! Abort the whole response
+	FAIL,
+	//! Return the results of the peers that did answer
+	SKIP
+};
+
+//! A peer httpserver instance together with its idle keep-alive connections
+class FlockPeer {
+public:
+	explicit FlockPeer(const std::string &url);
+
+	unique_ptr<duckdb_httplib_openssl::Client> Acquire();
+	void Release(unique_ptr<duckdb_httplib_openssl::Client> client);
+
+	const std::string &Url() const {
+		return url;
+	}
+	const std::string &Path() const {
+		return path;
+	}
+
+private:
+	std::string url;
+	std::string scheme_host_port;
+	std::string path;
+	std::mutex lock;
+	vector<unique_ptr<duckdb_httplib_openssl::Client>> idle;
+};
+
+//! Scatter-gather of queries across a fixed set of peer httpserver instances
+class FlockPeers {
+public:
+	//! Parses a comma separated list of peer base URLs, e.g. "http://10.0.0.1:9999,http://10.0.0.2:9999"
+	explicit FlockPeers(const std::string &peer_list);
+
+	bool Empty() const {
+		return peers.empty();
+	}
+
+	//! Sends the query to all peers in parallel and streams the concatenated results into the response.
+	//! Responds with 502 and the peer errors if the fan-out fails before anything could be sent
+	void HandleRequest(const duckdb_httplib_openssl::Request &req, duckdb_httplib_openssl::Response &res,
+	                   const std::string &query, const std::string &format, FlockFailurePolicy policy,
+	                   idx_t timeout_sec);
+
+private:
+	vector<unique_ptr<FlockPeer>> peers;
+};
+
+} // namespace duckdb
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace duckdb {
+
+//! A completed query as recorded in the query log
+struct QueryLogEntry {
+	timestamp_t timestamp;
+	std::string user;
+	hash_t query_hash = 0;
+	std::string query;
+	std::string format;
+	idx_t rows = 0;
+	idx_t bytes = 0;
+	double queue_time = 0;
+	double exec_time = 0;
+	double serialize_time = 0;
+	int32_t status = 0;
+	std::string client_address;
+};
+
+//! Fixed capacity ring buffer of the most recent queries. Writers never take a lock on the buffer, each slot is
+//! guarded by a sequence number (seqlock) so readers can detect and skip records that are being overwritten.
+class QueryLog {
+public:
+	static QueryLog &Get();
+
+	//! Upper bound of the capacity, a slot takes a little over 2KiB
+	static constexpr idx_t MAX_CAPACITY = 100000;
+
+	//! Drops all records and changes the capacity, 0 disables the log. Must not race with Record
+	void Reset(idx_t capacity);
+	void Record(const QueryLogEntry &entry);
+	//! Consistent copies of all records currently in the buffer, with their sequence numbers, oldest first
+	vector<std::pair<idx_t, QueryLogEntry>> Snapshot();
+
+	//! Writes full batches of records to Parquet files in the given directory. Records that are overwritten
+	//! before their batch is written are reported on stderr
+	void StartFlusher(DatabaseInstance &db, const std::string &directory);
+	void StopFlusher();
+
+	static void RegisterFunction(DatabaseInstance &db);
+
+private:
+	static constexpr idx_t MAX_USER_LENGTH = 64;
+	static constexpr idx_t MAX_QUERY_LENGTH = 2048;
+	static constexpr idx_t MAX_FORMAT_LENGTH = 32;
+	static constexpr idx_t MAX_ADDRESS_LENGTH = 64;
+
+	struct Slot {
+		//! 0 if empty, odd while being written, 2 * (seq + 1) once record seq is complete
+		std::atomic<uint64_t> sequence {0};
+		timestamp_t timestamp;
+		hash_t query_hash;
+		idx_t rows;
+		idx_t bytes;
+		double queue_time;
+		double exec_time;
+		double serialize_time;
+		int32_t status;
+		uint32_t user_length;
+		uint32_t query_length;
+		uint32_t format_length;
+		uint32_t address_length;
+		char user[MAX_USER_LENGTH];
+		char query[MAX_QUERY_LENGTH];
+		char format[MAX_FORMAT_LENGTH];
+		char address[MAX_ADDRESS_LENGTH];
+	};
+
+	void FlushLoop(DatabaseInstance &db, std::string file_prefix);
+
+	//! Guards the slot array against Reset, never taken by writers
+	std::mutex resize_lock;
+	unique_ptr<Slot[]> slots;
+	idx_t capacity = 0;
+	std::atomic<uint64_t> next_sequence {0};
+
+	std::mutex flush_lock;
+	std::condition_variable flush_cv;
+	bool flush_stop = false;
+	//! Records per Parquet file, 0 while no flusher runs
+	std::atomic<idx_t> flush_batch_size {0};
+	unique_ptr<std::thread> flusher;
+};
+
+} // namespace duckdb
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/file_system.hpp"
+
+namespace duckdb {
+
+//! A serialized response body parked in DuckDB's temp_directory while it is sent to the client.
+//! The file is removed when the last reference to the spilled response goes away.
+class SpilledResponse {
+public:
+	SpilledResponse(DatabaseInstance &db, const std::string &body);
+	~SpilledResponse();
+
+	idx_t Size() const {
+		return size;
+	}
+
+	void Read(char *buffer, idx_t offset, idx_t length);
+
+	//! Returns the directory spill files are written to, or an empty string if spilling is not possible
+	static std::string SpillDirectory(DatabaseInstance &db);
+	//! Removes spill files older than the TTL, e.g. left behind by a process that did not shut down cleanly
+	static void RemoveExpiredFiles(DatabaseInstance &db, idx_t ttl_seconds);
+
+private:
+	FileSystem &fs;
+	std::string path;
+	unique_ptr<FileHandle> handle;
+	idx_t size;
+};
+
+} // namespace duckdb
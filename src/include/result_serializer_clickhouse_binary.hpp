@@ -0,0 +1,54 @@
+#pragma once
+
+#include "duckdb/main/query_result.hpp"
+
+namespace duckdb {
+
+enum class ClickHouseBinaryFormat : uint8_t {
+	//! Row by row values, no header
+	ROW_BINARY,
+	//! Row by row values, preceded by the column names and types
+	ROW_BINARY_WITH_NAMES_AND_TYPES,
+	//! Column blocks, one per DataChunk
+	NATIVE
+};
+
+//! Serializes query results into ClickHouse's binary output formats, writing values straight from the vectors
+class ResultSerializerClickHouseBinary {
+public:
+	explicit ResultSerializerClickHouseBinary(const ClickHouseBinaryFormat _format) : format(_format) {
+	}
+
+	//! Returns true and sets the format if the name is one of the supported ClickHouse binary formats
+	static bool TryGetFormat(const std::string &name, ClickHouseBinaryFormat &result);
+
+	//! The ClickHouse type a DuckDB type is sent as, scalars are wrapped in Nullable if requested
+	static std::string ClickHouseTypeName(const LogicalType &type, bool nullable);
+
+	std::string Serialize(QueryResult &query_result);
+
+private:
+	void WriteHeader(QueryResult &query_result);
+	void WriteRows(DataChunk &chunk, const vector<LogicalType> &types);
+	void WriteBlock(DataChunk &chunk, const vector<string> &names, const vector<LogicalType> &types);
+
+	void WriteRowValue(Vector &input, const LogicalType &type, idx_t row_idx, bool parent_null, bool nullable);
+	void WriteColumn(Vector &input, const LogicalType &type, const vector<idx_t> &rows,
+	                 const vector<bool> &parent_nulls, bool nullable);
+	void WriteScalar(Vector &input, const LogicalType &type, idx_t row_idx, bool is_null);
+
+	void WriteVarUInt(uint64_t value);
+	void WriteString(const char *data, idx_t length);
+	void WriteString(const std::string &value) {
+		WriteString(value.c_str(), value.size());
+	}
+	template <class T>
+	void WriteFixed(T value) {
+		output.append(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	ClickHouseBinaryFormat format;
+	std::string output;
+};
+
+} // namespace duckdb
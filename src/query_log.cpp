@@ -0,0 +1,251 @@
+#include "query_log.hpp"
+
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/common/types/timestamp.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/extension_util.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace duckdb {
+
+QueryLog &QueryLog::Get() {
+	static QueryLog query_log;
+	return query_log;
+}
+
+void QueryLog::Reset(const idx_t new_capacity) {
+	std::lock_guard<std::mutex> guard(resize_lock);
+	slots = new_capacity > 0 ? unique_ptr<Slot[]>(new Slot[new_capacity]) : nullptr;
+	capacity = new_capacity;
+	next_sequence = 0;
+}
+
+static uint32_t CopyTruncated(char *target, const idx_t target_size, const std::string &source) {
+	auto length = MinValue<idx_t>(source.size(), target_size);
+	memcpy(target, source.data(), length);
+	return static_cast<uint32_t>(length);
+}
+
+void QueryLog::Record(const QueryLogEntry &entry) {
+	if (capacity == 0) {
+		return;
+	}
+	auto seq = next_sequence.fetch_add(1);
+	auto &slot = slots[seq % capacity];
+
+	// Claim the slot. Only contended if the buffer wrapped around while an older write is still in progress,
+	// in which case we wait for it, or drop our record if a newer one already took the slot
+	auto writing = 2 * seq + 1;
+	auto current = slot.sequence.load(std::memory_order_relaxed);
+	while (true) {
+		if (current >= writing) {
+			return;
+		}
+		if (current % 2 == 1) {
+			std::this_thread::yield();
+			current = slot.sequence.load(std::memory_order_relaxed);
+			continue;
+		}
+		if (slot.sequence.compare_exchange_weak(current, writing, std::memory_order_relaxed)) {
+			break;
+		}
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.timestamp = entry.timestamp;
+	slot.query_hash = entry.query_hash;
+	slot.rows = entry.rows;
+	slot.bytes = entry.bytes;
+	slot.queue_time = entry.queue_time;
+	slot.exec_time = entry.exec_time;
+	slot.serialize_time = entry.serialize_time;
+	slot.status = entry.status;
+	slot.user_length = CopyTruncated(slot.user, MAX_USER_LENGTH, entry.user);
+	slot.query_length = CopyTruncated(slot.query, MAX_QUERY_LENGTH, entry.query);
+	slot.format_length = CopyTruncated(slot.format, MAX_FORMAT_LENGTH, entry.format);
+	slot.address_length = CopyTruncated(slot.address, MAX_ADDRESS_LENGTH, entry.client_address);
+
+	slot.sequence.store(writing + 1, std::memory_order_release);
+
+	// Wake the flusher as soon as a batch is complete, so it gets written before it can be overwritten
+	auto batch_size = flush_batch_size.load(std::memory_order_relaxed);
+	if (batch_size > 0 && (seq + 1) % batch_size == 0) {
+		std::lock_guard<std::mutex> guard(flush_lock);
+		flush_cv.notify_one();
+	}
+}
+
+vector<std::pair<idx_t, QueryLogEntry>> QueryLog::Snapshot() {
+	std::lock_guard<std::mutex> guard(resize_lock);
+	vector<std::pair<idx_t, QueryLogEntry>> result;
+	for (idx_t idx = 0; idx < capacity; idx++) {
+		auto &slot = slots[idx];
+		auto before = slot.sequence.load(std::memory_order_acquire);
+		if (before == 0 || before % 2 == 1) {
+			continue;
+		}
+
+		QueryLogEntry entry;
+		entry.timestamp = slot.timestamp;
+		entry.query_hash = slot.query_hash;
+		entry.rows = slot.rows;
+		entry.bytes = slot.bytes;
+		entry.queue_time = slot.queue_time;
+		entry.exec_time = slot.exec_time;
+		entry.serialize_time = slot.serialize_time;
+		entry.status = slot.status;
+		entry.user.assign(slot.user, MinValue<idx_t>(slot.user_length, MAX_USER_LENGTH));
+		entry.query.assign(slot.query, MinValue<idx_t>(slot.query_length, MAX_QUERY_LENGTH));
+		entry.format.assign(slot.format, MinValue<idx_t>(slot.format_length, MAX_FORMAT_LENGTH));
+		entry.client_address.assign(slot.address, MinValue<idx_t>(slot.address_length, MAX_ADDRESS_LENGTH));
+
+		// Discard the copy if a writer touched the slot meanwhile
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != before) {
+			continue;
+		}
+		result.emplace_back(before / 2 - 1, std::move(entry));
+	}
+	std::sort(result.begin(), result.end(),
+	          [](const std::pair<idx_t, QueryLogEntry> &a, const std::pair<idx_t, QueryLogEntry> &b) {
+		          return a.first < b.first;
+	          });
+	return result;
+}
+
+void QueryLog::StartFlusher(DatabaseInstance &db, const std::string &directory) {
+	StopFlusher();
+	flush_stop = false;
+	// Half the buffer per batch, so a batch is written out while the other half fills up
+	flush_batch_size = MaxValue<idx_t>(capacity / 2, 1);
+	// Sequence numbers restart with every server start, so the start time keeps files of earlier runs apart
+	auto start = Timestamp::GetEpochMicroSeconds(Timestamp::GetCurrentTimestamp());
+	auto file_prefix = directory + "/query_log_" + std::to_string(start) + "_";
+	flusher = make_uniq<std::thread>([this, &db, file_prefix]() { FlushLoop(db, file_prefix); });
+}
+
+void QueryLog::StopFlusher() {
+	if (!flusher) {
+		return;
+	}
+	flush_batch_size = 0;
+	{
+		std::lock_guard<std::mutex> guard(flush_lock);
+		flush_stop = true;
+	}
+	flush_cv.notify_all();
+	if (flusher->joinable()) {
+		flusher->join();
+	}
+	flusher.reset();
+}
+
+static void LogFlushGap(idx_t start, idx_t end, idx_t written, const std::string &reason) {
+	fprintf(stderr, "httpserver: query log records %llu to %llu were not fully written to Parquet (%llu of %llu)%s%s\n",
+	        static_cast<unsigned long long>(start), static_cast<unsigned long long>(end - 1),
+	        static_cast<unsigned long long>(written), static_cast<unsigned long long>(end - start),
+	        reason.empty() ? "" : ": ", reason.c_str());
+	fflush(stderr);
+}
+
+void QueryLog::FlushLoop(DatabaseInstance &db, std::string file_prefix) {
+	auto batch_size = flush_batch_size.load();
+	idx_t flushed = next_sequence.load();
+	std::unique_lock<std::mutex> guard(flush_lock);
+	while (!flush_stop) {
+		flush_cv.wait_for(guard, std::chrono::seconds(1));
+		while (!flush_stop && next_sequence.load() >= flushed + batch_size) {
+			// Batches that fell out of the buffer already can only be reported, not written
+			auto recorded = next_sequence.load();
+			auto oldest = recorded > capacity ? recorded - capacity : 0;
+			if (flushed < oldest) {
+				auto skip_to = flushed + (oldest - flushed + batch_size - 1) / batch_size * batch_size;
+				LogFlushGap(flushed, skip_to, 0, "overwritten before the flush");
+				flushed = skip_to;
+				continue;
+			}
+
+			auto path = StringUtil::Replace(file_prefix + std::to_string(flushed) + ".parquet", "'", "''");
+			auto copy = StringUtil::Format("COPY (FROM httpserve_query_log() WHERE seq >= %llu AND seq < %llu) TO '%s' "
+			                               "(FORMAT parquet)",
+			                               flushed, flushed + batch_size, path);
+			guard.unlock();
+			idx_t written = 0;
+			std::string error;
+			try {
+				Connection con(db);
+				auto result = con.Query(copy);
+				if (result->HasError()) {
+					error = result->GetError();
+				} else {
+					written = result->GetValue(0, 0).GetValue<int64_t>();
+				}
+			} catch (const std::exception &ex) {
+				error = ex.what();
+			}
+			// Records missing from the snapshot were overwritten while the batch was copied
+			if (written < batch_size) {
+				LogFlushGap(flushed, flushed + batch_size, written, error);
+			}
+			guard.lock();
+			flushed += batch_size;
+		}
+	}
+}
+
+struct QueryLogScanState : public GlobalTableFunctionState {
+	vector<std::pair<idx_t, QueryLogEntry>> entries;
+	idx_t offset = 0;
+};
+
+static unique_ptr<FunctionData> QueryLogBind(ClientContext &context, TableFunctionBindInput &input,
+                                             vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"seq",   "timestamp",  "user",      "query_hash",     "query",  "format",        "rows",
+	         "bytes", "queue_time", "exec_time", "serialize_time", "status", "client_address"};
+	return_types = {LogicalType::UBIGINT, LogicalType::TIMESTAMP, LogicalType::VARCHAR, LogicalType::UBIGINT,
+	                LogicalType::VARCHAR, LogicalType::VARCHAR,   LogicalType::UBIGINT, LogicalType::UBIGINT,
+	                LogicalType::DOUBLE,  LogicalType::DOUBLE,    LogicalType::DOUBLE,  LogicalType::INTEGER,
+	                LogicalType::VARCHAR};
+	return nullptr;
+}
+
+static unique_ptr<GlobalTableFunctionState> QueryLogInit(ClientContext &context, TableFunctionInitInput &input) {
+	auto state = make_uniq<QueryLogScanState>();
+	state->entries = QueryLog::Get().Snapshot();
+	return std::move(state);
+}
+
+static void QueryLogScan(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	auto &state = data.global_state->Cast<QueryLogScanState>();
+	idx_t count = 0;
+	while (state.offset < state.entries.size() && count < STANDARD_VECTOR_SIZE) {
+		auto &seq = state.entries[state.offset].first;
+		auto &entry = state.entries[state.offset].second;
+		output.SetValue(0, count, Value::UBIGINT(seq));
+		output.SetValue(1, count, Value::TIMESTAMP(entry.timestamp));
+		output.SetValue(2, count, Value(entry.user));
+		output.SetValue(3, count, Value::UBIGINT(entry.query_hash));
+		output.SetValue(4, count, Value(entry.query));
+		output.SetValue(5, count, Value(entry.format));
+		output.SetValue(6, count, Value::UBIGINT(entry.rows));
+		output.SetValue(7, count, Value::UBIGINT(entry.bytes));
+		output.SetValue(8, count, Value::DOUBLE(entry.queue_time));
+		output.SetValue(9, count, Value::DOUBLE(entry.exec_time));
+		output.SetValue(10, count, Value::DOUBLE(entry.serialize_time));
+		output.SetValue(11, count, Value::INTEGER(entry.status));
+		output.SetValue(12, count, Value(entry.client_address));
+		state.offset++;
+		count++;
+	}
+	output.SetCardinality(count);
+}
+
+void QueryLog::RegisterFunction(DatabaseInstance &db) {
+	TableFunction httpserve_query_log("httpserve_query_log", {}, QueryLogScan, QueryLogBind, QueryLogInit);
+	ExtensionUtil::RegisterFunction(db, httpserve_query_log);
+}
+
+} // namespace duckdb
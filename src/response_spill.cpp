@@ -0,0 +1,83 @@
+#include "response_spill.hpp"
+
+#include "duckdb/common/types/uuid.hpp"
+#include "duckdb/main/config.hpp"
+
+namespace duckdb {
+
+static constexpr const char *SPILL_FILE_PREFIX = "httpserver_spill_";
+
+SpilledResponse::SpilledResponse(DatabaseInstance &db, const std::string &body)
+    : fs(FileSystem::GetFileSystem(db)), size(body.size()) {
+	auto directory = SpillDirectory(db);
+	if (directory.empty()) {
+		throw IOException("No temp_directory configured to spill the response to");
+	}
+	path = fs.JoinPath(directory, SPILL_FILE_PREFIX + UUID::ToString(UUID::GenerateRandomUUID()) + ".tmp");
+	handle = fs.OpenFile(path, FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_WRITE |
+	                               FileFlags::FILE_FLAGS_FILE_CREATE_NEW);
+	try {
+		handle->Write(const_cast<char *>(body.data()), size, 0);
+	} catch (...) {
+		handle.reset();
+		fs.TryRemoveFile(path);
+		throw;
+	}
+}
+
+SpilledResponse::~SpilledResponse() {
+	try {
+		handle.reset();
+		fs.TryRemoveFile(path);
+	} catch (...) { // NOLINT(bugprone-empty-catch)
+	}
+}
+
+void SpilledResponse::Read(char *buffer, idx_t offset, idx_t length) {
+	D_ASSERT(offset + length <= size);
+	handle->Read(buffer, length, offset);
+}
+
+std::string SpilledResponse::SpillDirectory(DatabaseInstance &db) {
+	auto &directory = DBConfig::GetConfig(db).options.temporary_directory;
+	if (directory.empty()) {
+		return directory;
+	}
+	auto &fs = FileSystem::GetFileSystem(db);
+	if (!fs.DirectoryExists(directory)) {
+		fs.CreateDirectory(directory);
+	}
+	return directory;
+}
+
+void SpilledResponse::RemoveExpiredFiles(DatabaseInstance &db, idx_t ttl_seconds) {
+	auto &directory = DBConfig::GetConfig(db).options.temporary_directory;
+	auto &fs = FileSystem::GetFileSystem(db);
+	if (directory.empty() || !fs.DirectoryExists(directory)) {
+		return;
+	}
+	vector<std::string> spill_files;
+	fs.ListFiles(directory, [&](const std::string &name, bool is_directory) {
+		if (!is_directory && StringUtil::StartsWith(name, SPILL_FILE_PREFIX)) {
+			spill_files.push_back(fs.JoinPath(directory, name));
+		}
+	});
+	auto now = time(nullptr);
+	for (auto &file : spill_files) {
+		try {
+			auto file_handle = fs.OpenFile(file, FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_NULL_IF_NOT_EXISTS);
+			if (!file_handle) {
+				continue;
+			}
+			auto modified = fs.GetLastModifiedTime(*file_handle);
+			file_handle.reset();
+			// Files younger than the TTL may still be streaming from another process sharing the directory
+			if (now - modified >= static_cast<time_t>(ttl_seconds)) {
+				fs.TryRemoveFile(file);
+			}
+		} catch (...) { // NOLINT(bugprone-empty-catch)
+		}
+	}
+}
+
+} // namespace duckdb
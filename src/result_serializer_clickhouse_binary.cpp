@@ -0,0 +1,469 @@
+#include "result_serializer_clickhouse_binary.hpp"
+
+#include "duckdb/common/types/decimal.hpp"
+#include "duckdb/common/types/vector.hpp"
+
+namespace duckdb {
+
+bool ResultSerializerClickHouseBinary::TryGetFormat(const std::string &name, ClickHouseBinaryFormat &result) {
+	if (name == "RowBinary") {
+		result = ClickHouseBinaryFormat::ROW_BINARY;
+	} else if (name == "RowBinaryWithNamesAndTypes") {
+		result = ClickHouseBinaryFormat::ROW_BINARY_WITH_NAMES_AND_TYPES;
+	} else if (name == "Native") {
+		result = ClickHouseBinaryFormat::NATIVE;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+// ClickHouse does not allow Nullable around composite types, their nulls are sent as empty values
+static bool IsNestedType(const LogicalType &type) {
+	switch (type.id()) {
+	case LogicalTypeId::LIST:
+	case LogicalTypeId::ARRAY:
+	case LogicalTypeId::MAP:
+	case LogicalTypeId::STRUCT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool IsPlainIdentifier(const std::string &name) {
+	if (name.empty() || isdigit(static_cast<unsigned char>(name[0]))) {
+		return false;
+	}
+	for (auto c : name) {
+		if (!isalnum(static_cast<unsigned char>(c)) && c != '_') {
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string ResultSerializerClickHouseBinary::ClickHouseTypeName( // NOLINT(*-no-recursion)
+    const LogicalType &type, const bool nullable) {
+	std::string name;
+	switch (type.id()) {
+	case LogicalTypeId::LIST:
+		return "Array(" + ClickHouseTypeName(ListType::GetChildType(type), true) + ")";
+	case LogicalTypeId::ARRAY:
+		return "Array(" + ClickHouseTypeName(ArrayType::GetChildType(type), true) + ")";
+	case LogicalTypeId::MAP:
+		return "Map(" + ClickHouseTypeName(MapType::KeyType(type), false) + ", " +
+		       ClickHouseTypeName(MapType::ValueType(type), true) + ")";
+	case LogicalTypeId::STRUCT: {
+		auto &children = StructType::GetChildTypes(type);
+		// Named tuples only if every element name can be written without quoting
+		auto named = true;
+		for (auto &child : children) {
+			named = named && IsPlainIdentifier(child.first);
+		}
+		name = "Tuple(";
+		for (idx_t idx = 0; idx < children.size(); idx++) {
+			if (idx > 0) {
+				name += ", ";
+			}
+			if (named) {
+				name += children[idx].first + " ";
+			}
+			name += ClickHouseTypeName(children[idx].second, true);
+		}
+		return name + ")";
+	}
+	case LogicalTypeId::BOOLEAN:
+		name = "Bool";
+		break;
+	case LogicalTypeId::TINYINT:
+		name = "Int8";
+		break;
+	case LogicalTypeId::SMALLINT:
+		name = "Int16";
+		break;
+	case LogicalTypeId::INTEGER:
+		name = "Int32";
+		break;
+	case LogicalTypeId::BIGINT:
+		name = "Int64";
+		break;
+	case LogicalTypeId::HUGEINT:
+		name = "Int128";
+		break;
+	case LogicalTypeId::UTINYINT:
+		name = "UInt8";
+		break;
+	case LogicalTypeId::USMALLINT:
+		name = "UInt16";
+		break;
+	case LogicalTypeId::UINTEGER:
+		name = "UInt32";
+		break;
+	case LogicalTypeId::UBIGINT:
+		name = "UInt64";
+		break;
+	case LogicalTypeId::UHUGEINT:
+		name = "UInt128";
+		break;
+	case LogicalTypeId::FLOAT:
+		name = "Float32";
+		break;
+	case LogicalTypeId::DOUBLE:
+		name = "Float64";
+		break;
+	case LogicalTypeId::DECIMAL:
+		name = "Decimal(" + std::to_string(DecimalType::GetWidth(type)) + ", " +
+		       std::to_string(DecimalType::GetScale(type)) + ")";
+		break;
+	case LogicalTypeId::DATE:
+		name = "Date32";
+		break;
+	case LogicalTypeId::TIMESTAMP_SEC:
+		name = "DateTime64(0)";
+		break;
+	case LogicalTypeId::TIMESTAMP_MS:
+		name = "DateTime64(3)";
+		break;
+	case LogicalTypeId::TIMESTAMP:
+		name = "DateTime64(6)";
+		break;
+	case LogicalTypeId::TIMESTAMP_NS:
+		name = "DateTime64(9)";
+		break;
+	case LogicalTypeId::TIMESTAMP_TZ:
+		name = "DateTime64(6, 'UTC')";
+		break;
+	case LogicalTypeId::UUID:
+		name = "UUID";
+		break;
+	default:
+		// VARCHAR and BLOB are sent as is, everything else in its string representation
+		name = "String";
+		break;
+	}
+	return nullable ? "Nullable(" + name + ")" : name;
+}
+
+void ResultSerializerClickHouseBinary::WriteVarUInt(uint64_t value) {
+	while (value >= 0x80) {
+		output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	output.push_back(static_cast<char>(value));
+}
+
+void ResultSerializerClickHouseBinary::WriteString(const char *data, const idx_t length) {
+	WriteVarUInt(length);
+	output.append(data, length);
+}
+
+// Appends a fixed width value from a flat vector, nulls are written as the default value
+template <class SRC, class DST = SRC>
+static void AppendFixed(std::string &output, Vector &input, const idx_t row_idx, const bool is_null) {
+	DST value = is_null ? DST() : static_cast<DST>(FlatVector::GetData<SRC>(input)[row_idx]);
+	output.append(reinterpret_cast<const char *>(&value), sizeof(DST));
+}
+
+void ResultSerializerClickHouseBinary::WriteScalar(Vector &input, const LogicalType &type, const idx_t row_idx,
+                                                   const bool is_null) {
+	switch (type.id()) {
+	case LogicalTypeId::BOOLEAN:
+		AppendFixed<bool, uint8_t>(output, input, row_idx, is_null);
+		break;
+	case LogicalTypeId::TINYINT:
+		AppendFixed<int8_t>(output, input, row_idx, is_null);
+		break;
+	case LogicalTypeId::SMALLINT:
+		AppendFixed<int16_t>(output, input, row_idx, is_null);
+		break;
+	case LogicalTypeId::INTEGER:
+	case LogicalTypeId::DATE:
+		AppendFixed<int32_t>(output, input, row_idx, is_null);
+		break;
+	case LogicalTypeId::BIGINT:
+	case LogicalTypeId::TIMESTAMP_SEC:
+	case LogicalTypeId::TIMESTAMP_MS:
+	case LogicalTypeId::TIMESTAMP:
+	case LogicalTypeId::TIMESTAMP_NS:
+	case LogicalTypeId::TIMESTAMP_TZ:
+		AppendFixed<int64_t>(output, input, row_idx, is_null);
+		break;
+	case LogicalTypeId::UTINYINT:
+		AppendFixed<uint8_t>(output, input, row_idx, is_null);
+		break;
+	case LogicalTypeId::USMALLINT:
+		AppendFixed<uint16_t>(output, input, row_idx, is_null);
+		break;
+	case LogicalTypeId::UINTEGER:
+		AppendFixed<uint32_t>(output, input, row_idx, is_null);
+		break;
+	case LogicalTypeId::UBIGINT:
+		AppendFixed<uint64_t>(output, input, row_idx, is_null);
+		break;
+	case LogicalTypeId::FLOAT:
+		AppendFixed<float>(output, input, row_idx, is_null);
+		break;
+	case LogicalTypeId::DOUBLE:
+		AppendFixed<double>(output, input, row_idx, is_null);
+		break;
+	case LogicalTypeId::HUGEINT: {
+		auto value = is_null ? hugeint_t(0) : FlatVector::GetData<hugeint_t>(input)[row_idx];
+		WriteFixed<uint64_t>(value.lower);
+		WriteFixed<int64_t>(value.upper);
+		break;
+	}
+	case LogicalTypeId::UHUGEINT: {
+		auto value = is_null ? uhugeint_t(0) : FlatVector::GetData<uhugeint_t>(input)[row_idx];
+		WriteFixed<uint64_t>(value.lower);
+		WriteFixed<uint64_t>(value.upper);
+		break;
+	}
+	case LogicalTypeId::DECIMAL:
+		// ClickHouse stores Decimal(P <= 9) in 32 bits, DuckDB already uses 16 bits up to width 4
+		switch (type.InternalType()) {
+		case PhysicalType::INT16:
+			AppendFixed<int16_t, int32_t>(output, input, row_idx, is_null);
+			break;
+		case PhysicalType::INT32:
+			AppendFixed<int32_t>(output, input, row_idx, is_null);
+			break;
+		case PhysicalType::INT64:
+			AppendFixed<int64_t>(output, input, row_idx, is_null);
+			break;
+		case PhysicalType::INT128: {
+			auto value = is_null ? hugeint_t(0) : FlatVector::GetData<hugeint_t>(input)[row_idx];
+			WriteFixed<uint64_t>(value.lower);
+			WriteFixed<int64_t>(value.upper);
+			break;
+		}
+		default:
+			throw InternalException("Unsupported decimal storage type " + TypeIdToString(type.InternalType()));
+		}
+		break;
+	case LogicalTypeId::UUID: {
+		// DuckDB flips the top bit to keep UUIDs sortable, ClickHouse sends the high half first
+		if (is_null) {
+			WriteFixed<uint64_t>(0);
+			WriteFixed<uint64_t>(0);
+			break;
+		}
+		auto value = FlatVector::GetData<hugeint_t>(input)[row_idx];
+		WriteFixed<uint64_t>(static_cast<uint64_t>(value.upper) ^ (uint64_t(1) << 63));
+		WriteFixed<uint64_t>(value.lower);
+		break;
+	}
+	case LogicalTypeId::VARCHAR:
+	case LogicalTypeId::BLOB: {
+		if (is_null) {
+			WriteVarUInt(0);
+			break;
+		}
+		auto &value = FlatVector::GetData<string_t>(input)[row_idx];
+		WriteString(value.GetData(), value.GetSize());
+		break;
+	}
+	default:
+		if (is_null) {
+			WriteVarUInt(0);
+			break;
+		}
+		WriteString(input.GetValue(row_idx).ToString());
+		break;
+	}
+}
+
+void ResultSerializerClickHouseBinary::WriteRowValue( // NOLINT(*-no-recursion)
+    Vector &input, const LogicalType &type, const idx_t row_idx, const bool parent_null, const bool nullable) {
+	const auto is_null = parent_null || !FlatVector::Validity(input).RowIsValid(row_idx);
+
+	switch (type.id()) {
+	case LogicalTypeId::LIST:
+	case LogicalTypeId::MAP: {
+		auto entry = is_null ? list_entry_t(0, 0) : FlatVector::GetData<list_entry_t>(input)[row_idx];
+		auto &child = ListVector::GetEntry(input);
+		child.Flatten(ListVector::GetListSize(input));
+		WriteVarUInt(entry.length);
+		for (idx_t idx = 0; idx < entry.length; idx++) {
+			if (type.id() == LogicalTypeId::LIST) {
+				WriteRowValue(child, ListType::GetChildType(type), entry.offset + idx, false, true);
+			} else {
+				auto &key_value = StructVector::GetEntries(child);
+				WriteRowValue(*key_value[0], MapType::KeyType(type), entry.offset + idx, false, false);
+				WriteRowValue(*key_value[1], MapType::ValueType(type), entry.offset + idx, false, true);
+			}
+		}
+		break;
+	}
+	case LogicalTypeId::ARRAY: {
+		auto array_size = is_null ? 0 : ArrayType::GetSize(type);
+		auto &child = ArrayVector::GetEntry(input);
+		child.Flatten(ArrayVector::GetTotalSize(input));
+		WriteVarUInt(array_size);
+		for (idx_t idx = 0; idx < array_size; idx++) {
+			WriteRowValue(child, ArrayType::GetChildType(type), row_idx * array_size + idx, false, true);
+		}
+		break;
+	}
+	case LogicalTypeId::STRUCT: {
+		auto &entries = StructVector::GetEntries(input);
+		auto &child_types = StructType::GetChildTypes(type);
+		for (idx_t idx = 0; idx < entries.size(); idx++) {
+			WriteRowValue(*entries[idx], child_types[idx].second, row_idx, is_null, true);
+		}
+		break;
+	}
+	default:
+		if (nullable) {
+			WriteFixed<uint8_t>(is_null ? 1 : 0);
+			if (is_null) {
+				break;
+			}
+		}
+		WriteScalar(input, type, row_idx, is_null);
+		break;
+	}
+}
+
+void ResultSerializerClickHouseBinary::WriteColumn( // NOLINT(*-no-recursion)
+    Vector &input, const LogicalType &type, const vector<idx_t> &rows, const vector<bool> &parent_nulls,
+    const bool nullable) {
+	auto &validity = FlatVector::Validity(input);
+	vector<bool> nulls(rows.size());
+	for (idx_t idx = 0; idx < rows.size(); idx++) {
+		nulls[idx] = parent_nulls[idx] || !validity.RowIsValid(rows[idx]);
+	}
+
+	switch (type.id()) {
+	case LogicalTypeId::LIST:
+	case LogicalTypeId::MAP:
+	case LogicalTypeId::ARRAY: {
+		// Cumulative offsets first, then the elements of all rows as one column
+		vector<idx_t> child_rows;
+		for (idx_t idx = 0; idx < rows.size(); idx++) {
+			if (!nulls[idx]) {
+				if (type.id() == LogicalTypeId::ARRAY) {
+					auto array_size = ArrayType::GetSize(type);
+					for (idx_t child_idx = 0; child_idx < array_size; child_idx++) {
+						child_rows.push_back(rows[idx] * array_size + child_idx);
+					}
+				} else {
+					auto &entry = FlatVector::GetData<list_entry_t>(input)[rows[idx]];
+					for (idx_t child_idx = 0; child_idx < entry.length; child_idx++) {
+						child_rows.push_back(entry.offset + child_idx);
+					}
+				}
+			}
+			WriteFixed<uint64_t>(child_rows.size());
+		}
+		vector<bool> child_nulls(child_rows.size(), false);
+		if (type.id() == LogicalTypeId::ARRAY) {
+			auto &child = ArrayVector::GetEntry(input);
+			child.Flatten(ArrayVector::GetTotalSize(input));
+			WriteColumn(child, ArrayType::GetChildType(type), child_rows, child_nulls, true);
+			break;
+		}
+		auto &child = ListVector::GetEntry(input);
+		child.Flatten(ListVector::GetListSize(input));
+		if (type.id() == LogicalTypeId::LIST) {
+			WriteColumn(child, ListType::GetChildType(type), child_rows, child_nulls, true);
+		} else {
+			auto &key_value = StructVector::GetEntries(child);
+			WriteColumn(*key_value[0], MapType::KeyType(type), child_rows, child_nulls, false);
+			WriteColumn(*key_value[1], MapType::ValueType(type), child_rows, child_nulls, true);
+		}
+		break;
+	}
+	case LogicalTypeId::STRUCT: {
+		auto &entries = StructVector::GetEntries(input);
+		auto &child_types = StructType::GetChildTypes(type);
+		for (idx_t idx = 0; idx < entries.size(); idx++) {
+			WriteColumn(*entries[idx], child_types[idx].second, rows, nulls, true);
+		}
+		break;
+	}
+	default:
+		// Nullable columns are a null map followed by the values, with defaults in place of nulls
+		if (nullable) {
+			for (idx_t idx = 0; idx < rows.size(); idx++) {
+				WriteFixed<uint8_t>(nulls[idx] ? 1 : 0);
+			}
+		}
+		for (idx_t idx = 0; idx < rows.size(); idx++) {
+			WriteScalar(input, type, rows[idx], nulls[idx]);
+		}
+		break;
+	}
+}
+
+void ResultSerializerClickHouseBinary::WriteHeader(QueryResult &query_result) {
+	WriteVarUInt(query_result.ColumnCount());
+	for (auto &name : query_result.names) {
+		WriteString(name);
+	}
+	for (auto &type : query_result.types) {
+		WriteString(ClickHouseTypeName(type, !IsNestedType(type)));
+	}
+}
+
+void ResultSerializerClickHouseBinary::WriteRows(DataChunk &chunk, const vector<LogicalType> &types) {
+	for (idx_t row_idx = 0; row_idx < chunk.size(); row_idx++) {
+		for (idx_t col_idx = 0; col_idx < chunk.ColumnCount(); col_idx++) {
+			auto &type = types[col_idx];
+			WriteRowValue(chunk.data[col_idx], type, row_idx, false, !IsNestedType(type));
+		}
+	}
+}
+
+void ResultSerializerClickHouseBinary::WriteBlock(DataChunk &chunk, const vector<string> &names,
+                                                  const vector<LogicalType> &types) {
+	WriteVarUInt(chunk.ColumnCount());
+	WriteVarUInt(chunk.size());
+
+	vector<idx_t> rows(chunk.size());
+	for (idx_t row_idx = 0; row_idx < chunk.size(); row_idx++) {
+		rows[row_idx] = row_idx;
+	}
+	vector<bool> parent_nulls(chunk.size(), false);
+
+	for (idx_t col_idx = 0; col_idx < chunk.ColumnCount(); col_idx++) {
+		auto &type = types[col_idx];
+		auto nullable = !IsNestedType(type);
+		WriteString(names[col_idx]);
+		WriteString(ClickHouseTypeName(type, nullable));
+		WriteColumn(chunk.data[col_idx], type, rows, parent_nulls, nullable);
+	}
+}
+
+std::string ResultSerializerClickHouseBinary::Serialize(QueryResult &query_result) {
+	auto names = query_result.names;
+	auto types = query_result.types;
+
+	if (format == ClickHouseBinaryFormat::ROW_BINARY_WITH_NAMES_AND_TYPES) {
+		WriteHeader(query_result);
+	}
+
+	auto wrote_block = false;
+	auto chunk = query_result.Fetch();
+	while (chunk) {
+		chunk->Flatten();
+		if (format == ClickHouseBinaryFormat::NATIVE) {
+			WriteBlock(*chunk, names, types);
+			wrote_block = true;
+		} else {
+			WriteRows(*chunk, types);
+		}
+		chunk = query_result.Fetch();
+	}
+
+	// Native clients still expect a block describing the columns of an empty result
+	if (format == ClickHouseBinaryFormat::NATIVE && !wrote_block) {
+		DataChunk empty;
+		empty.Initialize(Allocator::DefaultAllocator(), types);
+		WriteBlock(empty, names, types);
+	}
+
+	return std::move(output);
+}
+
+} // namespace duckdb
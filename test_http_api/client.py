@@ -10,19 +10,29 @@ from httpx import BasicAuth
 class ResponseFormat(Enum):
     ND_JSON = "JSONEachRow"
     COMPACT_JSON = "JSONCompact"
+    ROW_BINARY = "RowBinary"
+    ROW_BINARY_WITH_NAMES_AND_TYPES = "RowBinaryWithNamesAndTypes"
+    NATIVE = "Native"
 
 
 class Client:
-    def __init__(self, url: str, basic_auth: str | None = None, token_auth: str | None = None):
+    def __init__(self, url: str, basic_auth: str | None = None, token_auth: str | None = None, verify: bool = True):
         assert basic_auth is not None or token_auth is not None, "Set either basic_auth xor token_auth"
         assert not (basic_auth is not None and token_auth is not None), "Set either basic_auth xor token_auth"
 
         self._url = url
         self._basic_auth = basic_auth
         self._token_auth = token_auth
+        self._verify = verify
 
     def execute_query(self, sql: str, response_format: ResponseFormat) -> dict:
-        headers = {"format": response_format.value}
+        response = self.request(sql, response_format)
+        response.raise_for_status()
+        return response.json()
+
+    def request(self, sql: str, response_format: ResponseFormat, headers: dict | None = None,
+                params: dict | None = None) -> httpx.Response:
+        headers = {"format": response_format.value, **(headers or {})}
 
         if self._token_auth:
             headers["X-API-Key"] = self._token_auth
@@ -32,14 +42,12 @@ class Client:
             username, password = self._basic_auth.split(":")
             auth = BasicAuth(username, password)
 
-        with httpx.Client() as client:
-            response = client.get(self._url, params={"q": sql}, headers=headers, auth=auth)
-            response.raise_for_status()
-            return response.json()
+        with httpx.Client(verify=self._verify) as client:
+            return client.get(self._url, params={"q": sql, **(params or {})}, headers=headers, auth=auth)
 
 
     def ping(self) -> None:
-        with httpx.Client() as client:
+        with httpx.Client(verify=self._verify) as client:
             response = client.get(f"{self._url}/ping")
             response.raise_for_status()
 
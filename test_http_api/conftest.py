@@ -1,3 +1,6 @@
+from __future__ import annotations
+
+import os
 import subprocess
 from typing import Iterator
 
@@ -7,8 +10,13 @@ from .client import Client
 from .const import DEBUG_SHELL, HOST, PORT, API_KEY
 
 
-@pytest.fixture
-def http_duck_with_token() -> Iterator[Client]:
+def start_http_duck(
+    env: dict[str, str] | None = None,
+    port: int = PORT,
+    tls: tuple[str, str] | None = None,
+    init_sql: str = "",
+    api_key: str = API_KEY,
+) -> subprocess.Popen:
     process = subprocess.Popen(
         [
             DEBUG_SHELL,
@@ -17,16 +25,111 @@ def http_duck_with_token() -> Iterator[Client]:
         stdout=subprocess.PIPE,
         stderr=subprocess.PIPE,
         text=True,
-        bufsize=2^16
+        bufsize=2^16,
+        env={**os.environ, **(env or {})},
     )
 
     # Load the extension
     process.stdin.write("LOAD httpserver;\n")
-    cmd = f"SELECT httpserve_start('{HOST}', {PORT}, '{API_KEY}');\n"
+    if init_sql:
+        process.stdin.write(init_sql + "\n")
+    tls_args = f", '{tls[0]}', '{tls[1]}'" if tls else ""
+    cmd = f"SELECT httpserve_start('{HOST}', {port}, '{api_key}'{tls_args});\n"
     process.stdin.write(cmd)
+    process.stdin.flush()
+    return process
+
+
+@pytest.fixture
+def http_duck_with_token() -> Iterator[Client]:
+    process = start_http_duck()
 
     client = Client(f"http://{HOST}:{PORT}", token_auth=API_KEY)
     client.on_ready()
     yield client
 
     process.kill()
+
+
+@pytest.fixture
+def http_duck_with_etag() -> Iterator[Client]:
+    process = start_http_duck({"DUCKDB_HTTPSERVER_ETAG": "1"})
+
+    client = Client(f"http://{HOST}:{PORT}", token_auth=API_KEY)
+    client.on_ready()
+    yield client
+
+    process.kill()
+
+
+@pytest.fixture
+def http_duck_with_spill(tmp_path) -> Iterator[tuple[Client, str]]:
+    spill_dir = str(tmp_path / "spill")
+    process = start_http_duck(
+        {"DUCKDB_HTTPSERVER_SPILL_THRESHOLD": "1024"}, init_sql=f"SET temp_directory = '{spill_dir}';"
+    )
+
+    client = Client(f"http://{HOST}:{PORT}", token_auth=API_KEY)
+    client.on_ready()
+    yield client, spill_dir
+
+    process.kill()
+
+
+@pytest.fixture
+def http_duck_flock() -> Iterator[Client]:
+    peer_ports = [PORT + 1, PORT + 2]
+    peers = [start_http_duck(port=port) for port in peer_ports]
+    for port in peer_ports:
+        Client(f"http://{HOST}:{port}", token_auth=API_KEY).on_ready()
+
+    peer_urls = ",".join(f"http://{HOST}:{port}" for port in peer_ports)
+    process = start_http_duck({"DUCKDB_HTTPSERVER_PEERS": peer_urls})
+
+    client = Client(f"http://{HOST}:{PORT}", token_auth=API_KEY)
+    client.on_ready()
+    yield client
+
+    process.kill()
+    for peer in peers:
+        peer.kill()
+
+
+@pytest.fixture(params=["dead", "unauthorized"])
+def http_duck_flock_failing_peer(request) -> Iterator[Client]:
+    """A flock server with one working peer and one that is either not listening or rejects the credentials"""
+    live_port, failing_port = PORT + 1, PORT + 2
+    peers = [start_http_duck(port=live_port)]
+    Client(f"http://{HOST}:{live_port}", token_auth=API_KEY).on_ready()
+    if request.param == "unauthorized":
+        peers.append(start_http_duck(port=failing_port, api_key="other_key"))
+        Client(f"http://{HOST}:{failing_port}", token_auth="other_key").on_ready()
+
+    peer_urls = f"http://{HOST}:{live_port},http://{HOST}:{failing_port}"
+    process = start_http_duck({"DUCKDB_HTTPSERVER_PEERS": peer_urls, "DUCKDB_HTTPSERVER_FLOCK_TIMEOUT": "5"})
+
+    client = Client(f"http://{HOST}:{PORT}", token_auth=API_KEY)
+    client.on_ready()
+    yield client
+
+    process.kill()
+    for peer in peers:
+        peer.kill()
+
+
+@pytest.fixture
+def http_duck_with_tls(tmp_path) -> Iterator[Client]:
+    cert, key = str(tmp_path / "cert.pem"), str(tmp_path / "key.pem")
+    subprocess.run(
+        ["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1",
+         "-subj", f"/CN={HOST}", "-keyout", key, "-out", cert],
+        check=True,
+        capture_output=True,
+    )
+    process = start_http_duck(tls=(cert, key))
+
+    client = Client(f"https://{HOST}:{PORT}", token_auth=API_KEY, verify=False)
+    client.on_ready()
+    yield client
+
+    process.kill()
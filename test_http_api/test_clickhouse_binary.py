@@ -0,0 +1,73 @@
+from __future__ import annotations
+
+import struct
+
+from .client import Client, ResponseFormat
+
+
+def read_varuint(data: bytes, pos: int) -> tuple[int, int]:
+    value, shift = 0, 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return value, pos
+        shift += 7
+
+
+def read_string(data: bytes, pos: int) -> tuple[bytes, int]:
+    length, pos = read_varuint(data, pos)
+    return data[pos:pos + length], pos + length
+
+
+def query_binary(client: Client, sql: str, response_format: ResponseFormat) -> bytes:
+    response = client.request(sql, response_format)
+    response.raise_for_status()
+    return response.content
+
+
+def test_row_binary_with_names_and_types(http_duck_with_token: Client):
+    data = query_binary(
+        http_duck_with_token,
+        "SELECT 42::INTEGER AS a, 'duck' AS b, NULL::BIGINT AS c",
+        ResponseFormat.ROW_BINARY_WITH_NAMES_AND_TYPES,
+    )
+
+    count, pos = read_varuint(data, 0)
+    assert count == 3
+    names, types = [], []
+    for _ in range(count):
+        name, pos = read_string(data, pos)
+        names.append(name)
+    for _ in range(count):
+        tp, pos = read_string(data, pos)
+        types.append(tp)
+    assert names == [b"a", b"b", b"c"]
+    assert types == [b"Nullable(Int32)", b"Nullable(String)", b"Nullable(Int64)"]
+
+    assert data[pos] == 0
+    assert struct.unpack_from("<i", data, pos + 1)[0] == 42
+    pos += 5
+    assert data[pos] == 0
+    value, pos = read_string(data, pos + 1)
+    assert value == b"duck"
+    assert data[pos:] == b"\x01"
+
+
+def test_native_block(http_duck_with_token: Client):
+    data = query_binary(http_duck_with_token, "SELECT [1, 2]::INTEGER[] AS l FROM range(2)", ResponseFormat.NATIVE)
+
+    columns, pos = read_varuint(data, 0)
+    rows, pos = read_varuint(data, pos)
+    assert (columns, rows) == (1, 2)
+    name, pos = read_string(data, pos)
+    tp, pos = read_string(data, pos)
+    assert name == b"l"
+    assert tp == b"Array(Nullable(Int32))"
+
+    offsets = struct.unpack_from("<2Q", data, pos)
+    assert offsets == (2, 4)
+    pos += 16
+    assert data[pos:pos + 4] == b"\x00" * 4
+    assert struct.unpack_from("<4i", data, pos + 4) == (1, 2, 1, 2)
@@ -0,0 +1,65 @@
+from .client import Client, ResponseFormat
+from .conftest import start_http_duck
+from .const import API_KEY, HOST, PORT
+
+
+def test_etag_not_modified(http_duck_with_etag: Client):
+    http_duck_with_etag.execute_query("CREATE TABLE t AS SELECT 1 AS x", response_format=ResponseFormat.ND_JSON)
+
+    first = http_duck_with_etag.request("SELECT * FROM t", ResponseFormat.ND_JSON)
+    assert first.status_code == 200
+    etag = first.headers["ETag"]
+
+    cached = http_duck_with_etag.request("SELECT * FROM t", ResponseFormat.ND_JSON, {"If-None-Match": etag})
+    assert cached.status_code == 304
+    assert cached.content == b""
+
+    http_duck_with_etag.execute_query("INSERT INTO t VALUES (2)", response_format=ResponseFormat.ND_JSON)
+
+    changed = http_duck_with_etag.request("SELECT * FROM t", ResponseFormat.ND_JSON, {"If-None-Match": etag})
+    assert changed.status_code == 200
+    assert changed.headers["ETag"] != etag
+
+
+def test_etag_only_for_reads(http_duck_with_etag: Client):
+    response = http_duck_with_etag.request("CREATE TABLE u (x INTEGER)", ResponseFormat.ND_JSON)
+    assert response.status_code == 200
+    assert "ETag" not in response.headers
+
+
+def test_etag_not_reused_after_restart():
+    env = {"DUCKDB_HTTPSERVER_ETAG": "1"}
+    client = Client(f"http://{HOST}:{PORT}", token_auth=API_KEY)
+
+    process = start_http_duck(env)
+    try:
+        client.on_ready()
+        etag = client.request("SELECT 42 AS x", ResponseFormat.ND_JSON).headers["ETag"]
+    finally:
+        process.kill()
+        process.wait()
+
+    # The commit version starts over after a restart, the tag must not
+    process = start_http_duck(env)
+    try:
+        client.on_ready()
+        response = client.request("SELECT 42 AS x", ResponseFormat.ND_JSON, {"If-None-Match": etag})
+        assert response.status_code == 200
+        assert response.headers["ETag"] != etag
+    finally:
+        process.kill()
+
+
+def test_etag_invalidated_by_event_stream_write(http_duck_with_etag: Client):
+    http_duck_with_etag.execute_query("CREATE TABLE s AS SELECT 1 AS x", response_format=ResponseFormat.ND_JSON)
+    etag = http_duck_with_etag.request("SELECT * FROM s", ResponseFormat.ND_JSON).headers["ETag"]
+
+    # The playground sends every query as an event stream, including writes
+    write = http_duck_with_etag.request(
+        "INSERT INTO s VALUES (2)", ResponseFormat.ND_JSON, {"Accept": "text/event-stream"}
+    )
+    assert "event: result" in write.text
+
+    changed = http_duck_with_etag.request("SELECT * FROM s", ResponseFormat.ND_JSON, {"If-None-Match": etag})
+    assert changed.status_code == 200
+    assert changed.headers["ETag"] != etag
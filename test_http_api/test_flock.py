@@ -0,0 +1,81 @@
+import json
+
+import httpx
+
+from .client import Client, ResponseFormat
+from .const import API_KEY, HOST, PORT
+
+# Slow enough on the working peer that the failing one is always reported first
+SLOW_QUERY = "SELECT count(*) AS c FROM range(300000000) t(x) WHERE x % 7 = 0"
+
+
+def flock(query: str, **params: str) -> httpx.Response:
+    return httpx.post(
+        f"http://{HOST}:{PORT}/flock",
+        params=params,
+        content=query,
+        headers={"X-API-Key": API_KEY},
+        timeout=30,
+    )
+
+
+def test_flock_merges_peer_results(http_duck_flock: Client):
+    response = httpx.post(
+        f"http://{HOST}:{PORT}/flock",
+        content="SELECT 42 AS answer",
+        headers={"X-API-Key": API_KEY},
+    )
+    response.raise_for_status()
+
+    rows = [json.loads(line) for line in response.text.splitlines()]
+    assert rows == [{"answer": "42"}, {"answer": "42"}]
+
+
+def test_flock_rejects_unknown_policy(http_duck_flock: Client):
+    response = httpx.get(
+        f"http://{HOST}:{PORT}/flock",
+        params={"q": "SELECT 1", "flock_policy": "maybe"},
+        headers={"X-API-Key": API_KEY},
+    )
+    assert response.status_code == 400
+
+
+def test_flock_rejects_invalid_timeout(http_duck_flock: Client):
+    for timeout in ("", "abc", "0", "5s"):
+        response = httpx.get(
+            f"http://{HOST}:{PORT}/flock",
+            params={"q": "SELECT 1", "flock_timeout": timeout},
+            headers={"X-API-Key": API_KEY},
+        )
+        assert response.status_code == 400
+
+
+def test_flock_concatenates_row_binary(http_duck_flock: Client):
+    peer = Client(f"http://{HOST}:{PORT + 1}", token_auth=API_KEY)
+    single = peer.request("SELECT 42 AS answer", ResponseFormat.ROW_BINARY)
+    assert single.status_code == 200
+
+    response = flock("SELECT 42 AS answer", default_format="RowBinary")
+    assert response.status_code == 200
+    assert response.content == single.content * 2
+
+
+def test_flock_fail_policy_reports_failing_peer(http_duck_flock_failing_peer: Client):
+    response = flock(SLOW_QUERY, flock_policy="fail")
+    assert response.status_code == 502
+    assert f"{HOST}:{PORT + 2}" in response.text
+    assert f"{HOST}:{PORT + 1}" not in response.text
+
+
+def test_flock_skip_policy_returns_working_peers(http_duck_flock_failing_peer: Client):
+    response = flock("SELECT 42 AS answer", flock_policy="skip")
+    assert response.status_code == 200
+    rows = [json.loads(line) for line in response.text.splitlines()]
+    assert rows == [{"answer": "42"}]
+
+
+def test_flock_without_any_working_peer(http_duck_flock_failing_peer: Client):
+    # The failing peer makes every query fail, the working one fails on the unknown table
+    response = flock("SELECT * FROM missing_table", flock_policy="skip")
+    assert response.status_code == 502
+    assert "HTTP 500" in response.text
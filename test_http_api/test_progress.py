@@ -0,0 +1,81 @@
+import json
+
+from .client import Client, ResponseFormat
+
+SLOW_QUERY = "SELECT count(*) AS c FROM range(300000000) t(x) WHERE x % 7 = 0"
+
+
+def parse_events(body: str) -> list[tuple[str, str]]:
+    events = []
+    for block in body.split("\n\n"):
+        event, data = None, []
+        for line in block.split("\n"):
+            if line.startswith("event: "):
+                event = line[len("event: "):]
+            elif line.startswith("data: "):
+                data.append(line[len("data: "):])
+        if event:
+            events.append((event, "\n".join(data)))
+    return events
+
+
+def test_progress_headers(http_duck_with_token: Client):
+    response = http_duck_with_token.request(
+        "SELECT 42 AS answer", ResponseFormat.ND_JSON, params={"send_progress_in_http_headers": "1"}
+    )
+    assert response.status_code == 200
+    assert response.json() == {"answer": "42"}
+
+    progress = json.loads(response.headers["X-ClickHouse-Progress"])
+    assert set(progress) == {"read_rows", "read_bytes", "total_rows_to_read", "elapsed_ns"}
+
+    summary = json.loads(response.headers["X-ClickHouse-Summary"])
+    assert summary["result_rows"] == "1"
+    assert summary["result_bytes"] == str(len(response.content))
+    assert {"written_rows", "written_bytes", "total_rows_to_read", "elapsed_ns"} <= set(summary)
+
+
+def test_progress_event_stream(http_duck_with_token: Client):
+    response = http_duck_with_token.request(
+        SLOW_QUERY,
+        ResponseFormat.ND_JSON,
+        headers={"Accept": "text/event-stream"},
+        params={"http_headers_progress_interval_ms": "10"},
+    )
+    assert response.status_code == 200
+    assert response.headers["Content-Type"].startswith("text/event-stream")
+
+    events = parse_events(response.text)
+    assert [name for name, _ in events if name != "progress"] == ["result"]
+    assert json.loads(events[-1][1].strip()) == {"c": "42857143"}
+
+    progress = [json.loads(data) for name, data in events if name == "progress"]
+    assert progress
+    assert all(p["read_rows"] <= p["total_rows_to_read"] for p in progress)
+
+
+def test_progress_event_stream_error(http_duck_with_token: Client):
+    response = http_duck_with_token.request(
+        "SELECT * FROM missing_table", ResponseFormat.ND_JSON, headers={"Accept": "text/event-stream"}
+    )
+    events = parse_events(response.text)
+    assert events[-1][0] == "error"
+    assert "missing_table" in events[-1][1]
+
+
+def test_progress_event_stream_rejects_binary(http_duck_with_token: Client):
+    response = http_duck_with_token.request(
+        "SELECT 1", ResponseFormat.ROW_BINARY, headers={"Accept": "text/event-stream"}
+    )
+    assert response.status_code == 400
+
+
+def test_progress_interval_validated(http_duck_with_token: Client):
+    for interval in ("-1", "0", "abc", "99999999999999999999999"):
+        response = http_duck_with_token.request(
+            "SELECT 1",
+            ResponseFormat.ND_JSON,
+            headers={"Accept": "text/event-stream"},
+            params={"http_headers_progress_interval_ms": interval},
+        )
+        assert response.status_code == 400
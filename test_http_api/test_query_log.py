@@ -0,0 +1,59 @@
+import time
+
+from .client import Client, ResponseFormat
+from .conftest import start_http_duck
+from .const import API_KEY, HOST, PORT
+
+
+def test_query_log_records_queries(http_duck_with_token: Client):
+    http_duck_with_token.execute_query("SELECT * FROM range(3)", response_format=ResponseFormat.COMPACT_JSON)
+
+    res = http_duck_with_token.execute_query(
+        "SELECT query, format, rows, status, user FROM httpserve_query_log()",
+        response_format=ResponseFormat.COMPACT_JSON,
+    )
+
+    assert res["data"] == [["SELECT * FROM range(3)", "JSONCompact", 3, 200, "api_key"]]
+
+
+def write_two_batches(log_dir) -> list:
+    process = start_http_duck(
+        {"DUCKDB_HTTPSERVER_QUERY_LOG_SIZE": "8", "DUCKDB_HTTPSERVER_QUERY_LOG_PARQUET": str(log_dir)}
+    )
+    try:
+        client = Client(f"http://{HOST}:{PORT}", token_auth=API_KEY)
+        client.on_ready()
+        existing = set(log_dir.glob("query_log_*.parquet"))
+        for i in range(8):
+            client.execute_query(f"SELECT {i}", response_format=ResponseFormat.COMPACT_JSON)
+
+        # Completed batches are written right away, not on the next periodic wake up
+        deadline = time.time() + 0.9
+        while len(set(log_dir.glob("query_log_*.parquet")) - existing) < 2 and time.time() < deadline:
+            time.sleep(0.05)
+        batches = sorted(set(log_dir.glob("query_log_*.parquet")) - existing)
+        assert [batch.name.rsplit("_", 1)[1] for batch in batches] == ["0.parquet", "4.parquet"]
+
+        for batch in batches:
+            res = client.execute_query(f"SELECT count(*) FROM '{batch}'", response_format=ResponseFormat.COMPACT_JSON)
+            assert res["data"] == [[4]]
+        return batches
+    finally:
+        process.kill()
+        process.wait()
+
+
+def test_query_log_parquet_batches(tmp_path):
+    log_dir = tmp_path / "query_log"
+    log_dir.mkdir()
+    first_run = write_two_batches(log_dir)
+    # Sequence numbers restart, the files of the first run must survive the second
+    second_run = write_two_batches(log_dir)
+    assert all(batch.exists() for batch in first_run + second_run)
+
+
+def test_query_log_size_validated():
+    for size in ("abc", "-1", "100000000"):
+        process = start_http_duck({"DUCKDB_HTTPSERVER_QUERY_LOG_SIZE": size})
+        stdout, stderr = process.communicate(timeout=10)
+        assert "DUCKDB_HTTPSERVER_QUERY_LOG_SIZE" in stdout + stderr
@@ -0,0 +1,54 @@
+import os
+import time
+
+from .client import Client, ResponseFormat
+from .conftest import start_http_duck
+from .const import API_KEY, HOST, PORT
+
+LARGE_QUERY = "SELECT range AS x, 'row ' || range AS label FROM range(20000)"
+
+
+def spill_files(spill_dir: str) -> list[str]:
+    if not os.path.isdir(spill_dir):
+        return []
+    return [name for name in os.listdir(spill_dir) if name.startswith("httpserver_spill_")]
+
+
+def test_spilled_response_matches(http_duck_with_spill: tuple[Client, str]):
+    client, spill_dir = http_duck_with_spill
+
+    plain_port = PORT + 1
+    plain = start_http_duck(port=plain_port)
+    try:
+        plain_client = Client(f"http://{HOST}:{plain_port}", token_auth=API_KEY)
+        plain_client.on_ready()
+        expected = plain_client.request(LARGE_QUERY, ResponseFormat.ND_JSON)
+    finally:
+        plain.kill()
+
+    spilled = client.request(LARGE_QUERY, ResponseFormat.ND_JSON)
+    assert spilled.status_code == 200
+    assert int(spilled.headers["Content-Length"]) == len(spilled.content)
+    assert spilled.content == expected.content
+    # The spill directory is only created when a body is written to it
+    assert os.path.isdir(spill_dir)
+
+    # The file goes away once the response is destroyed, which may trail the client by a moment
+    deadline = time.time() + 5
+    while spill_files(spill_dir) and time.time() < deadline:
+        time.sleep(0.1)
+    assert spill_files(spill_dir) == []
+
+
+def test_small_response_not_spilled(http_duck_with_spill: tuple[Client, str]):
+    client, spill_dir = http_duck_with_spill
+    response = client.request("SELECT 1 AS x", ResponseFormat.ND_JSON)
+    assert response.json() == {"x": "1"}
+    assert spill_files(spill_dir) == []
+
+
+def test_invalid_spill_settings_rejected():
+    for env in ({"DUCKDB_HTTPSERVER_SPILL_THRESHOLD": "1MB"}, {"DUCKDB_HTTPSERVER_SPILL_TTL": "0"}):
+        process = start_http_duck(env)
+        stdout, stderr = process.communicate(timeout=10)
+        assert next(iter(env)) in stdout + stderr
@@ -0,0 +1,44 @@
+import socket
+import ssl
+
+import pytest
+
+from .client import Client, ResponseFormat
+from .const import HOST, PORT
+
+
+def test_tls_query(http_duck_with_tls: Client):
+    res = http_duck_with_tls.execute_query("SELECT 1 AS one", response_format=ResponseFormat.COMPACT_JSON)
+
+    assert res["data"] == [[1]]
+
+
+def ping_over_tls(context: ssl.SSLContext, session: ssl.SSLSession | None = None) -> ssl.SSLSocket:
+    raw = socket.create_connection((HOST, PORT), timeout=5)
+    tls = context.wrap_socket(raw, server_hostname=HOST, session=session)
+    tls.sendall(f"GET /ping HTTP/1.1\r\nHost: {HOST}\r\nConnection: close\r\n\r\n".encode())
+    # Reading to the end also picks up TLS 1.3 session tickets, which arrive after the handshake
+    response = b""
+    while chunk := tls.recv(4096):
+        response += chunk
+    assert response.startswith(b"HTTP/1.1 200")
+    return tls
+
+
+# TLS 1.2 resumes through the server side session cache, TLS 1.3 through session tickets
+@pytest.mark.parametrize("version", [ssl.TLSVersion.TLSv1_2, ssl.TLSVersion.TLSv1_3])
+def test_tls_session_resumption(http_duck_with_tls: Client, version: ssl.TLSVersion):
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    context.check_hostname = False
+    context.verify_mode = ssl.CERT_NONE
+    context.minimum_version = version
+    context.maximum_version = version
+
+    first = ping_over_tls(context)
+    assert not first.session_reused
+    session = first.session
+    first.close()
+
+    second = ping_over_tls(context, session)
+    assert second.session_reused
+    second.close()